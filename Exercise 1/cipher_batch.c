@@ -0,0 +1,327 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "cipher_batch.h"
+#include "cipher_command.h"
+#include "cipher_io.h"
+#include "cipher_parallel.h"
+
+#define MANIFEST_LINE_LENGTH 4096
+#define MANIFEST_FIELD_COUNT 4
+#define MANIFEST_DELIMITERS " \t\r\n"
+#define MANIFEST_COMMENT '#'
+#define INITIAL_CAPACITY 64
+#define BYTES_IN_MB (1024.0 * 1024.0)
+#define NANOS_IN_SECOND 1e9
+#define MILLIS_IN_SECOND 1e3
+
+typedef struct BatchJob
+{
+  char *command, *key, *input_path, *output_path;
+  int line_number;
+  CipherIoStatus status;
+  int invalid_key;
+  long long bytes;
+  double seconds;
+} BatchJob;
+
+typedef struct Batch
+{
+  BatchJob *jobs;
+  int count, capacity;
+  int next; // Index of the next job to hand out, guarded by lock
+  pthread_mutex_t lock;
+} Batch;
+
+static int load_manifest (const char *manifest_path, Batch *batch);
+static int add_job (Batch *batch, char *line, int line_number);
+static void free_batch (Batch *batch);
+static void *run_worker (void *arg);
+static void run_job (BatchJob *job, char *buffer);
+static int print_report (const Batch *batch, double seconds);
+static double get_time_seconds (void);
+
+int run_batch (const char *manifest_path, int threads)
+{
+  Batch batch = { NULL, 0, 0, 0, PTHREAD_MUTEX_INITIALIZER };
+  if (load_manifest (manifest_path, &batch) != 0)
+  {
+    free_batch (&batch);
+    return EXIT_FAILURE;
+  }
+
+  // Every worker shares the same batch, and pulls jobs until none are left.
+  int workers = threads < batch.count ? threads : batch.count;
+  workers = workers < 1 ? 1 : workers;
+
+  Batch **tasks = malloc (sizeof (Batch *) * workers);
+  if (tasks == NULL)
+  {
+    free_batch (&batch);
+    fprintf (stderr, "Failed to allocate memory.\n");
+    return EXIT_FAILURE;
+  }
+
+  for (int i = 0; i < workers; i++)
+  {
+    tasks[i] = &batch;
+  }
+
+  double start = get_time_seconds ();
+  cipher_parallel_run (&run_worker, tasks, sizeof (Batch *), workers);
+  double seconds = get_time_seconds () - start;
+
+  int result = print_report (&batch, seconds);
+
+  free (tasks);
+  free_batch (&batch);
+
+  return result;
+}
+
+/**
+ * @brief Reads all jobs of the given manifest into the batch.
+ *
+ * @return 0 upon success, 1 if the manifest couldn't be read or is invalid
+ */
+static int load_manifest (const char *manifest_path, Batch *batch)
+{
+  FILE *manifest = fopen (manifest_path, "r");
+  if (manifest == NULL)
+  {
+    fprintf (stderr, "The given file is invalid.\n");
+    return 1;
+  }
+
+  char line[MANIFEST_LINE_LENGTH];
+  int line_number = 0;
+  int result = 0;
+
+  while (result == 0 && fgets (line, sizeof (line), manifest) != NULL)
+  {
+    line_number++;
+
+    // A line longer than the buffer would be read as several lines. A full
+    // buffer is fine only if the line ends right after it.
+    if (strchr (line, '\n') == NULL && !feof (manifest))
+    {
+      int next = fgetc (manifest);
+      if (next != '\n' && next != EOF)
+      {
+        fprintf (stderr, "Line %d of the manifest is invalid.\n",
+                 line_number);
+        result = 1;
+        continue;
+      }
+    }
+
+    result = add_job (batch, line, line_number);
+  }
+
+  fclose (manifest);
+  return result;
+}
+
+/**
+ * @brief Parses a single manifest line and adds its job to the batch.
+ *
+ * @return 0 upon success (or if the line is skipped), 1 otherwise
+ */
+static int add_job (Batch *batch, char *line, int line_number)
+{
+  char *fields[MANIFEST_FIELD_COUNT];
+  int field_count = 0;
+
+  for (char *field = strtok (line, MANIFEST_DELIMITERS);
+       field != NULL && field_count <= MANIFEST_FIELD_COUNT;
+       field = strtok (NULL, MANIFEST_DELIMITERS))
+  {
+    if (field_count < MANIFEST_FIELD_COUNT)
+    {
+      fields[field_count] = field;
+    }
+    field_count++;
+  }
+
+  if (field_count == 0 || fields[0][0] == MANIFEST_COMMENT)
+  {
+    return 0;
+  }
+
+  if (field_count != MANIFEST_FIELD_COUNT
+      || !cipher_command_is_valid (fields[0]))
+  {
+    fprintf (stderr, "Line %d of the manifest is invalid.\n", line_number);
+    return 1;
+  }
+
+  if (batch->count == batch->capacity)
+  {
+    int capacity = batch->capacity == 0 ? INITIAL_CAPACITY
+                                        : batch->capacity * 2;
+    BatchJob *jobs = realloc (batch->jobs, sizeof (BatchJob) * capacity);
+    if (jobs == NULL)
+    {
+      fprintf (stderr, "Failed to allocate memory.\n");
+      return 1;
+    }
+
+    batch->jobs = jobs;
+    batch->capacity = capacity;
+  }
+
+  BatchJob *job = &batch->jobs[batch->count];
+  *job = (BatchJob) { .line_number = line_number,
+                      .status = CIPHER_IO_SUCCESS };
+
+  char **copies[MANIFEST_FIELD_COUNT]
+      = { &job->command, &job->key, &job->input_path, &job->output_path };
+  for (int i = 0; i < MANIFEST_FIELD_COUNT; i++)
+  {
+    *copies[i] = malloc (strlen (fields[i]) + 1);
+    if (*copies[i] == NULL)
+    {
+      for (int j = 0; j < i; j++)
+      {
+        free (*copies[j]);
+      }
+      fprintf (stderr, "Failed to allocate memory.\n");
+      return 1;
+    }
+    strcpy (*copies[i], fields[i]);
+  }
+
+  batch->count++;
+  return 0;
+}
+
+static void free_batch (Batch *batch)
+{
+  for (int i = 0; i < batch->count; i++)
+  {
+    free (batch->jobs[i].command);
+    free (batch->jobs[i].key);
+    free (batch->jobs[i].input_path);
+    free (batch->jobs[i].output_path);
+  }
+
+  free (batch->jobs);
+  batch->jobs = NULL;
+  batch->count = 0;
+}
+
+/**
+ * @brief Runs jobs of the batch until none are left, through one buffer.
+ *
+ * @param arg pointer to a pointer to the batch
+ * @return NULL
+ */
+static void *run_worker (void *arg)
+{
+  Batch *batch = *(Batch **) arg;
+
+  char *buffer = malloc (CIPHER_IO_DEFAULT_BLOCK_SIZE);
+
+  while (1)
+  {
+    pthread_mutex_lock (&batch->lock);
+    int index = batch->next++;
+    pthread_mutex_unlock (&batch->lock);
+
+    if (index >= batch->count)
+    {
+      break;
+    }
+
+    if (buffer == NULL)
+    {
+      batch->jobs[index].status = CIPHER_IO_ALLOCATION_ERROR;
+      continue;
+    }
+
+    run_job (&batch->jobs[index], buffer);
+  }
+
+  free (buffer);
+  return NULL;
+}
+
+/**
+ * @brief Runs a single job, and records its status, size and time.
+ */
+static void run_job (BatchJob *job, char *buffer)
+{
+  double start = get_time_seconds ();
+
+  CipherEngine engine;
+  if (cipher_command_init_engine (job->command, job->key, &engine) != 0)
+  {
+    job->invalid_key = 1;
+    return;
+  }
+
+  job->status = cipher_io_transform_buffered (
+      &engine, job->input_path, job->output_path, buffer,
+      CIPHER_IO_DEFAULT_BLOCK_SIZE);
+  cipher_engine_free (&engine);
+
+  struct stat output_stat;
+  job->bytes = stat (job->output_path, &output_stat) == 0
+                   ? (long long) output_stat.st_size
+                   : 0;
+  job->seconds = get_time_seconds () - start;
+}
+
+/**
+ * @brief Prints the time of every job and of the whole batch.
+ *
+ * @return 0 if all jobs succeeded, 1 otherwise
+ */
+static int print_report (const Batch *batch, double seconds)
+{
+  long long total_bytes = 0;
+  int failures = 0;
+
+  for (int i = 0; i < batch->count; i++)
+  {
+    const BatchJob *job = &batch->jobs[i];
+
+    if (job->invalid_key || job->status != CIPHER_IO_SUCCESS)
+    {
+      failures++;
+      printf ("FAILED %s %s -> %s: %s\n", job->command, job->input_path,
+              job->output_path,
+              job->invalid_key ? "The given shift value is invalid."
+                               : cipher_io_status_message (job->status));
+      continue;
+    }
+
+    total_bytes += job->bytes;
+    printf ("%s %s -> %s: %lld bytes in %.3f ms\n", job->command,
+            job->input_path, job->output_path, job->bytes,
+            job->seconds * MILLIS_IN_SECOND);
+  }
+
+  printf ("Batch: %d files, %d failed, %lld bytes in %.3f ms (%.1f MB/s)\n",
+          batch->count, failures, total_bytes, seconds * MILLIS_IN_SECOND,
+          seconds > 0 ? ((double) total_bytes / BYTES_IN_MB) / seconds : 0);
+
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Returns a monotonic timestamp in seconds.
+ */
+static double get_time_seconds (void)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+
+  return (double) now.tv_sec + ((double) now.tv_nsec / NANOS_IN_SECOND);
+}
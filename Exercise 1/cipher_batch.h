@@ -0,0 +1,19 @@
+#ifndef CIPHER_BATCH_H
+#define CIPHER_BATCH_H
+
+/**
+ * Runs many cipher jobs in a single process.
+ * The manifest holds one job per line, as whitespace separated fields:
+ *   <command> <k> <input path> <output path>
+ * where command is any cipher command (encode, decode, encode_keyed,
+ * decode_keyed). Empty lines and lines starting with '#' are skipped.
+ * The jobs are spread over a pool of worker threads, each reusing a single
+ * buffer across all of its files, and the time of every job and of the whole
+ * batch is printed.
+ * @param manifest_path path of the manifest.
+ * @param threads number of worker threads.
+ * @return 0 if all jobs succeeded, 1 otherwise.
+ */
+int run_batch (const char *manifest_path, int threads);
+
+#endif //CIPHER_BATCH_H
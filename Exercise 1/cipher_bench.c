@@ -0,0 +1,373 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cipher_bench.h"
+#include "cipher_engine.h"
+#include "cipher_parallel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BENCH_HAS_TSC 1
+#include <x86intrin.h>
+#endif
+
+#define BENCH_KEY 29
+#define BENCH_KEYS { 3, -7, 29, 11, 100 }
+#define BENCH_SEED 42
+#define BENCH_REPEATS 3
+#define BENCH_LINE_LENGTH 80
+#define BYTES_IN_GB (1024.0 * 1024.0 * 1024.0)
+#define NANOS_IN_SECOND 1e9
+
+// The reference loop is ~100 times slower, so it only runs on a slice.
+#define REFERENCE_MAX_SIZE (8 * 1024 * 1024)
+
+typedef enum CorpusType
+{
+  CORPUS_LETTERS,
+  CORPUS_MIXED,
+  CORPUS_BINARY,
+  CORPUS_LONG_LINE,
+  CORPUS_COUNT
+} CorpusType;
+
+typedef enum BenchPath
+{
+  BENCH_MEMCPY,
+  BENCH_REFERENCE,
+  BENCH_TABLE,
+  BENCH_SSE2,
+  BENCH_AVX2,
+  BENCH_KEYED,
+  BENCH_THREADS,
+  BENCH_PATH_COUNT
+} BenchPath;
+
+typedef struct BenchTiming
+{
+  double seconds;
+  double cycles;
+} BenchTiming;
+
+static const char *corpus_names[CORPUS_COUNT]
+    = { "letters", "mixed", "binary", "long-line" };
+static const char *path_names[BENCH_PATH_COUNT]
+    = { "memcpy", "reference", "table", "sse2", "avx2", "keyed", "threads" };
+
+static void fill_corpus (char *buffer, size_t length, CorpusType type);
+static int is_path_supported (BenchPath path);
+static int init_path_engine (BenchPath path, CipherEngine *engine);
+static int run_scalar_path (BenchPath path, const char *input, char *output,
+                            size_t length);
+static BenchTiming time_path (BenchPath path, const CipherEngine *engine,
+                              const char *input, char *output, size_t length,
+                              int threads);
+static void run_path (BenchPath path, const CipherEngine *engine,
+                      const char *input, char *output, size_t length,
+                      int threads);
+static double get_time_seconds (void);
+static double get_cycles (void);
+
+int run_benchmark (size_t size, int threads)
+{
+  char *input = malloc (size);
+  char *output = malloc (size);
+  char *expected = malloc (size);
+  char *expected_keyed = malloc (size);
+
+  if (input == NULL || output == NULL || expected == NULL
+      || expected_keyed == NULL)
+  {
+    free (input);
+    free (output);
+    free (expected);
+    free (expected_keyed);
+    fprintf (stderr, "Failed to allocate the benchmark buffers.\n");
+    return EXIT_FAILURE;
+  }
+
+  // Touching the output pages up front, so page faults aren't timed.
+  memset (output, 0, size);
+
+  printf ("%-10s %-10s %10s %10s %10s\n", "corpus", "path", "GB/s",
+          "cycles/B", "vs memcpy");
+
+  int result = 1;
+  for (int corpus = 0; corpus < CORPUS_COUNT; corpus++)
+  {
+    fill_corpus (input, size, corpus);
+    if (run_scalar_path (BENCH_TABLE, input, expected, size) != 0
+        || run_scalar_path (BENCH_KEYED, input, expected_keyed, size) != 0)
+    {
+      fprintf (stderr, "Failed to allocate the key schedule.\n");
+      result = 0;
+      break;
+    }
+
+    double memcpy_rate = 0;
+    for (int path = 0; path < BENCH_PATH_COUNT; path++)
+    {
+      if (!is_path_supported (path))
+      {
+        continue;
+      }
+
+      size_t length = (path == BENCH_REFERENCE && size > REFERENCE_MAX_SIZE)
+                          ? REFERENCE_MAX_SIZE
+                          : size;
+      // Building the engine (and the key schedule) isn't timed
+      CipherEngine engine;
+      if (init_path_engine (path, &engine) != 0)
+      {
+        fprintf (stderr, "Failed to allocate the key schedule.\n");
+        result = 0;
+        continue;
+      }
+
+      BenchTiming timing = time_path (path, &engine, input, output, length,
+                                      threads);
+      cipher_engine_free (&engine);
+
+      double rate = ((double) length / BYTES_IN_GB) / timing.seconds;
+      memcpy_rate = (path == BENCH_MEMCPY) ? rate : memcpy_rate;
+
+      printf ("%-10s %-10s %10.3f", corpus_names[corpus], path_names[path],
+              rate);
+      if (timing.cycles > 0)
+      {
+        printf (" %10.3f", timing.cycles / (double) length);
+      }
+      else
+      {
+        printf (" %10s", "-");
+      }
+      printf (" %9.2fx\n", rate / memcpy_rate);
+
+      // The key schedule is checked against its own scalar loop, and memcpy
+      // doesn't encode.
+      const char *reference = (path == BENCH_KEYED) ? expected_keyed
+                                                    : expected;
+      if (path != BENCH_MEMCPY && memcmp (output, reference, length) != 0)
+      {
+        fprintf (stderr, "The %s output differs from the scalar one on %s.\n",
+                 path_names[path], corpus_names[corpus]);
+        result = 0;
+      }
+    }
+  }
+
+  free (input);
+  free (output);
+  free (expected);
+  free (expected_keyed);
+
+  return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Fills the given buffer with a synthetic corpus.
+ *
+ * @param buffer buffer to fill
+ * @param length length of the buffer
+ * @param type kind of corpus to generate
+ */
+static void fill_corpus (char *buffer, size_t length, CorpusType type)
+{
+  static const char letters[]
+      = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  static const char printable[]
+      = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"
+        " .,!?;:'\"()-";
+
+  // xorshift64 - much faster than rand() for hundreds of megabytes.
+  uint64_t state = BENCH_SEED;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    switch (type)
+    {
+    case CORPUS_LETTERS:
+      buffer[i] = letters[state % (sizeof (letters) - 1)];
+      break;
+    case CORPUS_MIXED:
+      buffer[i] = (i % BENCH_LINE_LENGTH == BENCH_LINE_LENGTH - 1)
+                      ? '\n'
+                      : printable[state % (sizeof (printable) - 1)];
+      break;
+    case CORPUS_BINARY:
+      buffer[i] = (char) (state >> 56);
+      break;
+    default:
+      // A single line of words, without any newline
+      buffer[i] = (state % 6 == 0) ? ' ' : letters[state % 26];
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Checks whether the given path can run on this CPU.
+ */
+static int is_path_supported (BenchPath path)
+{
+  switch (path)
+  {
+  case BENCH_SSE2:
+    return cipher_path_supported (CIPHER_PATH_SSE2);
+  case BENCH_AVX2:
+    return cipher_path_supported (CIPHER_PATH_AVX2);
+  default:
+    return 1;
+  }
+}
+
+/**
+ * @brief Prepares the engine the given path encodes with.
+ *
+ * @param path path to prepare the engine of
+ * @param engine engine to initialize, released with cipher_engine_free
+ * @return 0 upon success, 1 if allocating the key schedule failed
+ */
+static int init_path_engine (BenchPath path, CipherEngine *engine)
+{
+  const int keys[] = BENCH_KEYS;
+
+  if (path == BENCH_KEYED)
+  {
+    return cipher_engine_init_keyed (engine, keys,
+                                     sizeof (keys) / sizeof (keys[0]));
+  }
+
+  cipher_engine_init (engine, BENCH_KEY);
+  engine->path = (path == BENCH_TABLE)  ? CIPHER_PATH_SCALAR
+                 : (path == BENCH_SSE2) ? CIPHER_PATH_SSE2
+                 : (path == BENCH_AVX2) ? CIPHER_PATH_AVX2
+                                        : engine->path;
+  return 0;
+}
+
+/**
+ * @brief Encodes the input into the output with the given path's engine,
+ * without any SIMD kernel - the expected output of the path's kernels.
+ *
+ * @param path path to encode with
+ * @param input bytes to encode
+ * @param output buffer to write the encoded bytes to
+ * @param length number of bytes to encode
+ * @return 0 upon success, 1 if allocating the key schedule failed
+ */
+static int run_scalar_path (BenchPath path, const char *input, char *output,
+                            size_t length)
+{
+  CipherEngine engine;
+  if (init_path_engine (path, &engine) != 0)
+  {
+    return 1;
+  }
+
+  engine.path = CIPHER_PATH_SCALAR;
+  run_path (path, &engine, input, output, length, 1);
+  cipher_engine_free (&engine);
+
+  return 0;
+}
+
+/**
+ * @brief Runs the given path BENCH_REPEATS times and returns the fastest run.
+ *
+ * @param path path to time
+ * @param engine the path's engine, from init_path_engine
+ * @param input bytes to encode
+ * @param output buffer to write the encoded bytes to
+ * @param length number of bytes to encode
+ * @param threads number of threads for the multithreaded path
+ * @return the time and cycles of the fastest run
+ */
+static BenchTiming time_path (BenchPath path, const CipherEngine *engine,
+                              const char *input, char *output, size_t length,
+                              int threads)
+{
+  BenchTiming best = { 0, 0 };
+
+  for (int i = 0; i < BENCH_REPEATS; i++)
+  {
+    double start_cycles = get_cycles ();
+    double start = get_time_seconds ();
+
+    run_path (path, engine, input, output, length, threads);
+
+    double seconds = get_time_seconds () - start;
+    double cycles = get_cycles () - start_cycles;
+
+    if (i == 0 || seconds < best.seconds)
+    {
+      best.seconds = seconds;
+      best.cycles = cycles;
+    }
+  }
+
+  return best;
+}
+
+/**
+ * @brief Encodes the input into the output with the given path.
+ *
+ * @param path path to encode with
+ * @param engine the path's engine, from init_path_engine
+ * @param input bytes to encode
+ * @param output buffer to write the encoded bytes to
+ * @param length number of bytes to encode
+ * @param threads number of threads for the multithreaded path
+ */
+static void run_path (BenchPath path, const CipherEngine *engine,
+                      const char *input, char *output, size_t length,
+                      int threads)
+{
+  switch (path)
+  {
+  case BENCH_MEMCPY:
+    memcpy (output, input, length);
+    break;
+  case BENCH_REFERENCE:
+    memcpy (output, input, length);
+    cipher_reference_process (output, length, BENCH_KEY);
+    break;
+  case BENCH_THREADS:
+    cipher_parallel_process (engine, input, output, length, threads);
+    break;
+  default:
+    cipher_engine_process (engine, input, output, length);
+    break;
+  }
+}
+
+/**
+ * @brief Returns a monotonic timestamp in seconds.
+ */
+static double get_time_seconds (void)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+
+  return (double) now.tv_sec + ((double) now.tv_nsec / NANOS_IN_SECOND);
+}
+
+/**
+ * @brief Returns the CPU's timestamp counter, or 0 where there is none.
+ */
+static double get_cycles (void)
+{
+#ifdef BENCH_HAS_TSC
+  return (double) __rdtsc ();
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,23 @@
+#ifndef CIPHER_BENCH_H
+#define CIPHER_BENCH_H
+
+#include <stddef.h>
+
+#define BENCH_DEFAULT_SIZE (64 * 1024 * 1024)
+
+/**
+ * Benchmarks every cipher path on synthetic corpora (letters only, mixed
+ * text, binary and a single long line) and prints, per corpus and path, the
+ * throughput in GB/s, the cycles spent per byte and the speed relative to a
+ * plain memcpy of the same buffer.
+ * The paths are: the reference per-step loop, the table, every SIMD kernel
+ * supported by the CPU, a key schedule, and the fastest kernel on several
+ * threads. Every path's output is checked against the table's, and the key
+ * schedule's against its scalar loop. Preparing an engine isn't timed.
+ * @param size size of each corpus, in bytes.
+ * @param threads number of threads for the multithreaded path.
+ * @return 0 upon success, 1 if an allocation failed or the outputs differ.
+ */
+int run_benchmark (size_t size, int threads);
+
+#endif //CIPHER_BENCH_H
@@ -0,0 +1,102 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cipher_command.h"
+
+#define STRTOL_BASE 10
+#define KEYS_DELIMITER ','
+
+static int parse_keys (const char *str, int keys[], size_t *key_count);
+
+int cipher_command_is_valid (const char *command)
+{
+  return strcmp (command, "encode") == 0 || strcmp (command, "decode") == 0
+         || cipher_command_is_keyed (command);
+}
+
+int cipher_command_is_keyed (const char *command)
+{
+  return strcmp (command, "encode_keyed") == 0
+         || strcmp (command, "decode_keyed") == 0;
+}
+
+int cipher_command_init_engine (const char *command, const char *key_arg,
+                                CipherEngine *engine)
+{
+  if (cipher_command_is_keyed (command))
+  {
+    int *keys = malloc (sizeof (int) * CIPHER_MAX_KEYS);
+    size_t key_count = 0;
+
+    int result = keys == NULL || parse_keys (key_arg, keys, &key_count) != 0
+                 || cipher_engine_init_keyed (engine, keys, key_count) != 0;
+
+    free (keys);
+    if (result != 0)
+    {
+      return 1;
+    }
+  }
+  else
+  {
+    // Setting endptr & errno to detect whether the returned value of strtol
+    // is a valid integer, or whether the action failed.
+    char *endptr = NULL;
+    errno = 0;
+
+    long k = strtol (key_arg, &endptr, STRTOL_BASE);
+    if (errno != 0 || endptr == key_arg || *endptr || k < INT_MIN
+        || k > INT_MAX)
+    {
+      return 1;
+    }
+
+    cipher_engine_init (engine, (int) k);
+  }
+
+  if (strncmp (command, "decode", strlen ("decode")) == 0)
+  {
+    cipher_engine_invert (engine);
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Parses a comma separated list of shift values.
+ *
+ * @param str the list to parse
+ * @param keys array of CIPHER_MAX_KEYS keys to fill
+ * @param key_count set to the number of keys parsed
+ * @return 0 if the list is valid, 1 otherwise
+ */
+static int parse_keys (const char *str, int keys[], size_t *key_count)
+{
+  *key_count = 0;
+
+  while (*key_count < CIPHER_MAX_KEYS)
+  {
+    char *endptr = NULL;
+    errno = 0;
+
+    long k = strtol (str, &endptr, STRTOL_BASE);
+    if (errno != 0 || endptr == str || k < INT_MIN || k > INT_MAX
+        || (*endptr != KEYS_DELIMITER && *endptr != '\0'))
+    {
+      return 1;
+    }
+
+    keys[(*key_count)++] = (int) k;
+
+    if (*endptr == '\0')
+    {
+      return 0;
+    }
+
+    str = endptr + 1;
+  }
+
+  return 1;
+}
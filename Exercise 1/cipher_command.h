@@ -0,0 +1,41 @@
+#ifndef CIPHER_COMMAND_H
+#define CIPHER_COMMAND_H
+
+#include "cipher_engine.h"
+
+/**
+ * The cipher commands shared by the CLI and batch manifests:
+ * encode/decode receive a single shift value, while encode_keyed/decode_keyed
+ * receive a comma separated list of shift values (a key schedule).
+ */
+
+/**
+ * @brief Checks whether the given command is a cipher command.
+ *
+ * @param command command to check
+ * @return 1 if the command is valid, 0 otherwise
+ */
+int cipher_command_is_valid (const char *command);
+
+/**
+ * @brief Checks whether the given command receives a key schedule.
+ *
+ * @param command command to check
+ * @return 1 if the command is keyed, 0 otherwise
+ */
+int cipher_command_is_keyed (const char *command);
+
+/**
+ * @brief Prepares the engine of the given command.
+ * The engine must be released with cipher_engine_free.
+ *
+ * @param command a valid command
+ * @param key_arg the command's shift value(s)
+ * @param engine engine to initialize
+ * @return 0 upon success, 1 if the shift value(s) are invalid or allocation
+ *         failed
+ */
+int cipher_command_init_engine (const char *command, const char *key_arg,
+                                CipherEngine *engine);
+
+#endif //CIPHER_COMMAND_H
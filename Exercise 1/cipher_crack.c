@@ -0,0 +1,140 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cipher_crack.h"
+
+#define CASE_BIT 0x20
+#define BYTE_VALUES 256
+
+/**
+ * Relative frequencies of the letters 'a' to 'z' in english text, in percent.
+ */
+static const double english_frequencies[ALPHABET_SINGLE_SIZE]
+    = { 8.167, 1.492, 2.782, 4.253, 12.702, 2.228, 2.015, 6.094, 6.966,
+        0.153, 0.772, 4.025, 2.406, 6.749,  7.507, 1.929, 0.095, 5.987,
+        6.327, 9.056, 2.758, 0.978, 2.360,  0.150, 1.974, 0.074 };
+
+void cipher_crack_histogram (const char *buffer, size_t length,
+                             unsigned long long histogram[])
+{
+  // Counting all byte values first keeps the hot loop free of branches.
+  unsigned long long counts[BYTE_VALUES] = { 0 };
+  const unsigned char *bytes = (const unsigned char *) buffer;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    counts[bytes[i]]++;
+  }
+
+  for (int i = 0; i < ALPHABET_SINGLE_SIZE; i++)
+  {
+    histogram[i] += counts[ALPHABET_LOWER_START + i]
+                    + counts[ALPHABET_UPPER_START + i];
+  }
+}
+
+int cipher_crack_best_shift (const unsigned long long histogram[])
+{
+  unsigned long long total = 0;
+  for (int i = 0; i < ALPHABET_SINGLE_SIZE; i++)
+  {
+    total += histogram[i];
+  }
+
+  if (total == 0)
+  {
+    return 0;
+  }
+
+  int best_shift = 0;
+  double best_score = 0;
+
+  for (int shift = 0; shift < ALPHABET_SINGLE_SIZE; shift++)
+  {
+    // Decoding with this shift, letter i would have been encoded as
+    // letter (i + shift).
+    double score = 0;
+    for (int i = 0; i < ALPHABET_SINGLE_SIZE; i++)
+    {
+      double expected = (double) total * english_frequencies[i] / 100.0;
+      double observed
+          = (double) histogram[(i + shift) % ALPHABET_SINGLE_SIZE];
+      score += ((observed - expected) * (observed - expected)) / expected;
+    }
+
+    if (shift == 0 || score < best_score)
+    {
+      best_shift = shift;
+      best_score = score;
+    }
+  }
+
+  return best_shift;
+}
+
+CipherIoStatus cipher_crack_file (const char *input_path, size_t sample_size,
+                                  int *k)
+{
+  int fd = open (input_path, O_RDONLY);
+  if (fd < 0)
+  {
+    return CIPHER_IO_FILE_ERROR;
+  }
+
+  // The file is read again to decode it, so it can't be a pipe.
+  struct stat input_stat;
+  if (fstat (fd, &input_stat) != 0 || !S_ISREG (input_stat.st_mode))
+  {
+    close (fd);
+    return CIPHER_IO_FILE_ERROR;
+  }
+
+  char *buffer = malloc (CIPHER_IO_DEFAULT_BLOCK_SIZE);
+  if (buffer == NULL)
+  {
+    close (fd);
+    return CIPHER_IO_ALLOCATION_ERROR;
+  }
+
+  unsigned long long histogram[ALPHABET_SINGLE_SIZE] = { 0 };
+  CipherIoStatus status = CIPHER_IO_SUCCESS;
+  size_t remaining = sample_size;
+
+  while (sample_size == 0 || remaining > 0)
+  {
+    size_t wanted = CIPHER_IO_DEFAULT_BLOCK_SIZE;
+    if (sample_size != 0 && remaining < wanted)
+    {
+      wanted = remaining;
+    }
+
+    ssize_t length = read (fd, buffer, wanted);
+    if (length < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (length < 0)
+    {
+      status = CIPHER_IO_READ_ERROR;
+      break;
+    }
+    if (length == 0)
+    {
+      break;
+    }
+
+    cipher_crack_histogram (buffer, (size_t) length, histogram);
+    remaining -= sample_size != 0 ? (size_t) length : 0;
+  }
+
+  free (buffer);
+  close (fd);
+
+  *k = cipher_crack_best_shift (histogram);
+  return status;
+}
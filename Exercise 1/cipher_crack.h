@@ -0,0 +1,49 @@
+#ifndef CIPHER_CRACK_H
+#define CIPHER_CRACK_H
+
+#include <stddef.h>
+
+#include "cipher_engine.h"
+#include "cipher_io.h"
+
+/**
+ * Recovers the shift value of a caesar encoded text, without decoding it 52
+ * times: a single pass counts the letters, every candidate shift is scored
+ * against the letter frequencies of english with a chi-squared test, and the
+ * text is decoded once with the best one.
+ * Keys k and k + 26 encode the same way, so the recovered shift value is in
+ * [0, 26).
+ */
+
+/**
+ * @brief Counts the letters of the given buffer, ignoring their case.
+ *
+ * @param buffer bytes to count
+ * @param length number of bytes
+ * @param histogram array of 26 counters, the counts are added to it
+ */
+void cipher_crack_histogram (const char *buffer, size_t length,
+                             unsigned long long histogram[]);
+
+/**
+ * @brief Finds the shift value that most likely encoded an english text with
+ * the given letter counts.
+ *
+ * @param histogram array of 26 letter counts of the encoded text
+ * @return the most likely shift value, in [0, 26)
+ */
+int cipher_crack_best_shift (const unsigned long long histogram[]);
+
+/**
+ * @brief Recovers the shift value the given file was encoded with.
+ *
+ * @param input_path path of the encoded file, must be a regular file
+ * @param sample_size number of bytes to sample from the start of the file,
+ *                    or 0 to sample the whole file
+ * @param k set to the recovered shift value
+ * @return CIPHER_IO_SUCCESS if the file was read, an error otherwise
+ */
+CipherIoStatus cipher_crack_file (const char *input_path, size_t sample_size,
+                                  int *k);
+
+#endif //CIPHER_CRACK_H
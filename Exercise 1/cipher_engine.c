@@ -0,0 +1,346 @@
+#include <stdlib.h>
+
+#include "cipher_engine.h"
+#include "cipher_simd.h"
+
+#define CASE_BIT 0x20
+
+typedef enum CharType
+{
+  LOWER_CHAR,
+  UPPER_CHAR
+} CharType;
+
+int shift_character (int remainder, char c, CharType type);
+
+static void cipher_engine_process_single (const CipherEngine *engine,
+                                          const char *input, char *output,
+                                          size_t length);
+static int get_effective_shift (int k);
+static void build_table (CipherEngine *engine);
+static unsigned char rotate_byte (unsigned char c, int shift);
+
+CipherPath cipher_best_path (void)
+{
+  if (cipher_simd_has_avx2 ())
+  {
+    return CIPHER_PATH_AVX2;
+  }
+
+  return cipher_simd_has_sse2 () ? CIPHER_PATH_SSE2 : CIPHER_PATH_SCALAR;
+}
+
+int cipher_path_supported (CipherPath path)
+{
+  switch (path)
+  {
+  case CIPHER_PATH_AVX2:
+    return cipher_simd_has_avx2 ();
+  case CIPHER_PATH_SSE2:
+    return cipher_simd_has_sse2 ();
+  default:
+    return 1;
+  }
+}
+
+int cipher_decode_key (int k)
+{
+  // Negating the remainder rather than k itself, so INT_MIN doesn't overflow.
+  return (-1) * (k % ALPHABET_SIZE);
+}
+
+/**
+ * @brief Prepares the given engine for encoding with the given key.
+ *
+ * @param engine engine to initialize
+ * @param k key to use
+ */
+void cipher_engine_init (CipherEngine *engine, int k)
+{
+  engine->shift = get_effective_shift (k);
+  engine->path = cipher_best_path ();
+  engine->period = 1;
+  engine->pattern = NULL;
+
+  build_table (engine);
+}
+
+/**
+ * @brief Prepares the given engine for encoding with a repeating key schedule.
+ * A single key is a plain caesar cipher, and needs no schedule.
+ *
+ * @param engine engine to initialize
+ * @param keys keys to use, one per position
+ * @param key_count number of keys, between 1 and CIPHER_MAX_KEYS
+ * @return 0 upon success, 1 if the keys are invalid or allocation failed
+ */
+int cipher_engine_init_keyed (CipherEngine *engine, const int keys[],
+                              size_t key_count)
+{
+  if (key_count == 0 || key_count > CIPHER_MAX_KEYS)
+  {
+    return 1;
+  }
+
+  cipher_engine_init (engine, keys[0]);
+  if (key_count == 1)
+  {
+    return 0;
+  }
+
+  unsigned char *pattern = malloc (key_count + CIPHER_PATTERN_PADDING);
+  if (pattern == NULL)
+  {
+    return 1;
+  }
+
+  for (size_t i = 0; i < key_count + CIPHER_PATTERN_PADDING; i++)
+  {
+    pattern[i] = (unsigned char) get_effective_shift (keys[i % key_count]);
+  }
+
+  engine->period = key_count;
+  engine->pattern = pattern;
+
+  return 0;
+}
+
+void cipher_engine_invert (CipherEngine *engine)
+{
+  engine->shift = (ALPHABET_SINGLE_SIZE - engine->shift) % ALPHABET_SINGLE_SIZE;
+  build_table (engine);
+
+  if (engine->pattern != NULL)
+  {
+    for (size_t i = 0; i < engine->period + CIPHER_PATTERN_PADDING; i++)
+    {
+      engine->pattern[i] = (ALPHABET_SINGLE_SIZE - engine->pattern[i])
+                           % ALPHABET_SINGLE_SIZE;
+    }
+  }
+}
+
+void cipher_engine_free (CipherEngine *engine)
+{
+  free (engine->pattern);
+  engine->pattern = NULL;
+  engine->period = 1;
+}
+
+/**
+ * @brief Encodes the given buffer with the engine's kernel, and the tail that
+ * doesn't fill a whole vector with a single table lookup per byte.
+ *
+ * @param engine initialized engine
+ * @param input bytes to encode
+ * @param output buffer to write the encoded bytes to
+ * @param length number of bytes to encode
+ */
+void cipher_engine_process (const CipherEngine *engine, const char *input,
+                            char *output, size_t length)
+{
+  cipher_engine_process_at (engine, input, output, length, 0);
+}
+
+/**
+ * @brief Encodes the given buffer as if it was at the given position.
+ * A key schedule is encoded with the engine's kernel, loading the shifts of
+ * each vector from the unrolled schedule, and its tail one byte at a time.
+ *
+ * @param engine initialized engine
+ * @param input bytes to encode
+ * @param output buffer to write the encoded bytes to
+ * @param length number of bytes to encode
+ * @param position position of the first byte in the whole buffer
+ */
+void cipher_engine_process_at (const CipherEngine *engine, const char *input,
+                               char *output, size_t length,
+                               unsigned long long position)
+{
+  if (engine->pattern == NULL)
+  {
+    cipher_engine_process_single (engine, input, output, length);
+    return;
+  }
+
+  const unsigned char *in = (const unsigned char *) input;
+  unsigned char *out = (unsigned char *) output;
+  size_t phase = (size_t) (position % engine->period);
+
+  size_t i = 0;
+  if (engine->path == CIPHER_PATH_AVX2)
+  {
+    i = cipher_simd_process_keyed_avx2 (engine->pattern, engine->period,
+                                        phase, in, out, length);
+  }
+  else if (engine->path == CIPHER_PATH_SSE2)
+  {
+    i = cipher_simd_process_keyed_sse2 (engine->pattern, engine->period,
+                                        phase, in, out, length);
+  }
+
+  phase = (phase + (i % engine->period)) % engine->period;
+  for (; i < length; i++)
+  {
+    out[i] = rotate_byte (in[i], engine->pattern[phase]);
+    phase = (phase + 1 == engine->period) ? 0 : phase + 1;
+  }
+}
+
+/**
+ * @brief Encodes the given buffer with a single key.
+ *
+ * @param engine initialized engine, without a key schedule
+ * @param input bytes to encode
+ * @param output buffer to write the encoded bytes to
+ * @param length number of bytes to encode
+ */
+static void cipher_engine_process_single (const CipherEngine *engine,
+                                          const char *input, char *output,
+                                          size_t length)
+{
+  const unsigned char *in = (const unsigned char *) input;
+  unsigned char *out = (unsigned char *) output;
+
+  size_t i = 0;
+  if (engine->path == CIPHER_PATH_AVX2)
+  {
+    i = cipher_simd_process_avx2 (engine->shift, in, out, length);
+  }
+  else if (engine->path == CIPHER_PATH_SSE2)
+  {
+    i = cipher_simd_process_sse2 (engine->shift, in, out, length);
+  }
+
+  for (; i < length; i++)
+  {
+    out[i] = engine->table[in[i]];
+  }
+}
+
+/**
+ * @brief Encodes the given buffer with the original per-step loop.
+ *
+ * @param buffer bytes to encode
+ * @param length number of bytes to encode
+ * @param k key to use
+ */
+void cipher_reference_process (char *buffer, size_t length, int k)
+{
+  int remainder = (k % ALPHABET_SIZE);
+
+  for (size_t index = 0; index < length; index++)
+  {
+    if (buffer[index] >= ALPHABET_UPPER_START
+        && buffer[index] <= ALPHABET_UPPER_END)
+    {
+      buffer[index] = shift_character (remainder, buffer[index], UPPER_CHAR);
+    }
+    else if (buffer[index] >= ALPHABET_LOWER_START
+             && buffer[index] <= ALPHABET_LOWER_END)
+    {
+      buffer[index] = shift_character (remainder, buffer[index], LOWER_CHAR);
+    }
+  }
+}
+
+/**
+ * @brief Shifts the given character by the given remainder.
+ *
+ * @param remainder the remainder to shift by
+ * @param c character to shift
+ * @param type type of character to shift
+ * @return the shifted character
+ */
+int shift_character (int remainder, char c, CharType type)
+{
+  while (remainder != 0)
+  {
+    c = c + (remainder > 0 ? 1 : -1);
+
+    if (type == LOWER_CHAR)
+    {
+      if (c > ALPHABET_LOWER_END)
+      {
+        c = ALPHABET_LOWER_START;
+      }
+      if (c < ALPHABET_LOWER_START)
+      {
+        c = ALPHABET_LOWER_END;
+      }
+    }
+
+    if (type == UPPER_CHAR)
+    {
+      if (c > ALPHABET_UPPER_END)
+      {
+        c = ALPHABET_UPPER_START;
+      }
+      if (c < ALPHABET_UPPER_START)
+      {
+        c = ALPHABET_UPPER_END;
+      }
+    }
+
+    remainder = remainder + (remainder > 0 ? -1 : 1);
+  }
+
+  return c;
+}
+
+/**
+ * @brief Returns the shift inside a single alphabet that the given key moves
+ * letters by. Shifting by the remainder steps over the same alphabet back and
+ * forth, so the effective shift is the remainder modulo a single alphabet.
+ *
+ * @param k key to use
+ * @return shift in [0, 26)
+ */
+static int get_effective_shift (int k)
+{
+  int remainder = (k % ALPHABET_SIZE) % ALPHABET_SINGLE_SIZE;
+  return (remainder + ALPHABET_SINGLE_SIZE) % ALPHABET_SINGLE_SIZE;
+}
+
+/**
+ * @brief Builds the engine's translation table from its shift.
+ * Every byte is mapped to itself, except for letters which are rotated inside
+ * their own alphabet.
+ *
+ * @param engine engine to build the table of
+ */
+static void build_table (CipherEngine *engine)
+{
+  for (int c = 0; c < CIPHER_TABLE_SIZE; c++)
+  {
+    engine->table[c] = (unsigned char) c;
+  }
+
+  for (int i = 0; i < ALPHABET_SINGLE_SIZE; i++)
+  {
+    int shifted = (i + engine->shift) % ALPHABET_SINGLE_SIZE;
+    engine->table[ALPHABET_UPPER_START + i] = ALPHABET_UPPER_START + shifted;
+    engine->table[ALPHABET_LOWER_START + i] = ALPHABET_LOWER_START + shifted;
+  }
+}
+
+/**
+ * @brief Rotates a single byte by the given shift, if it's a letter.
+ *
+ * @param c byte to rotate
+ * @param shift effective shift inside a single alphabet, in [0, 26)
+ * @return the rotated byte
+ */
+static unsigned char rotate_byte (unsigned char c, int shift)
+{
+  // Setting the case bit folds 'A'-'Z' onto 'a'-'z'. Computed without
+  // branches, since letters and other bytes are usually mixed at random.
+  unsigned char offset
+      = (unsigned char) ((c | CASE_BIT) - ALPHABET_LOWER_START);
+  int is_letter = offset < ALPHABET_SINGLE_SIZE;
+  int wraps = offset + shift >= ALPHABET_SINGLE_SIZE;
+
+  return (unsigned char) (c
+                          + is_letter
+                                * (shift - (wraps * ALPHABET_SINGLE_SIZE)));
+}
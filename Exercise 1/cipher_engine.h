@@ -0,0 +1,145 @@
+#ifndef CIPHER_ENGINE_H
+#define CIPHER_ENGINE_H
+
+#include <stddef.h>
+
+#define ALPHABET_SINGLE_SIZE 26
+#define ALPHABET_SIZE (ALPHABET_SINGLE_SIZE * 2)
+#define ALPHABET_UPPER_START 'A'
+#define ALPHABET_UPPER_END 'Z'
+#define ALPHABET_LOWER_START 'a'
+#define ALPHABET_LOWER_END 'z'
+
+#define CIPHER_TABLE_SIZE 256
+#define CIPHER_MAX_KEYS 4096
+
+// Longest vector a kernel loads from a key schedule, in bytes
+#define CIPHER_PATTERN_PADDING 32
+
+/**
+ * The kernels an engine can encode with, from the slowest to the fastest.
+ */
+typedef enum CipherPath
+{
+  CIPHER_PATH_SCALAR,
+  CIPHER_PATH_SSE2,
+  CIPHER_PATH_AVX2
+} CipherPath;
+
+/**
+ * A caesar cipher prepared for a single key.
+ * The translation table maps every possible byte to its encoded value, so
+ * encoding a buffer costs a single lookup per byte. On x86 the engine encodes
+ * with vectorized kernels instead, and uses the table for the tail only.
+ *
+ * An engine may also hold a repeating key schedule (a vigenere cipher), where
+ * the byte at position i is shifted by keys[i % period]. The schedule is
+ * stored unrolled past its period, so a kernel can load the shifts of a whole
+ * vector starting at any phase.
+ */
+typedef struct CipherEngine
+{
+  int shift; // Effective shift inside a single alphabet, in [0, 26)
+  CipherPath path;
+  unsigned char table[CIPHER_TABLE_SIZE];
+  size_t period; // Number of keys in the schedule, 1 for a single key
+  unsigned char *pattern; // Unrolled schedule, NULL for a single key
+} CipherEngine;
+
+/**
+ * @brief Returns the fastest kernel supported by the running CPU.
+ */
+CipherPath cipher_best_path (void);
+
+/**
+ * @brief Checks whether the given kernel is supported by the running CPU.
+ *
+ * @param path kernel to check
+ * @return 1 if the kernel can be used, 0 otherwise
+ */
+int cipher_path_supported (CipherPath path);
+
+/**
+ * @brief Returns the key that decodes what the given key encodes.
+ *
+ * @param k key to invert
+ * @return key to encode with in order to decode
+ */
+int cipher_decode_key (int k);
+
+/**
+ * @brief Prepares the given engine for encoding with the given key, using the
+ * fastest supported kernel. The kernel may be replaced afterwards by setting
+ * ${path} to another supported one.
+ * Decoding with k is the same as encoding with -k.
+ *
+ * @param engine engine to initialize
+ * @param k key to use
+ */
+void cipher_engine_init (CipherEngine *engine, int k);
+
+/**
+ * @brief Prepares the given engine for encoding with a repeating key schedule.
+ * The engine must be released with cipher_engine_free.
+ *
+ * @param engine engine to initialize
+ * @param keys keys to use, one per position
+ * @param key_count number of keys, between 1 and CIPHER_MAX_KEYS
+ * @return 0 upon success, 1 if the keys are invalid or allocation failed
+ */
+int cipher_engine_init_keyed (CipherEngine *engine, const int keys[],
+                              size_t key_count);
+
+/**
+ * @brief Turns the given engine into one that decodes what it used to encode.
+ *
+ * @param engine initialized engine
+ */
+void cipher_engine_invert (CipherEngine *engine);
+
+/**
+ * @brief Releases the memory held by the given engine.
+ *
+ * @param engine initialized engine
+ */
+void cipher_engine_free (CipherEngine *engine);
+
+/**
+ * @brief Encodes ${length} bytes of input into output using the engine's key.
+ * The buffers are binary-safe (NUL bytes are copied as is) and input may be
+ * the same buffer as output.
+ *
+ * @param engine initialized engine
+ * @param input bytes to encode
+ * @param output buffer to write the encoded bytes to
+ * @param length number of bytes to encode
+ */
+void cipher_engine_process (const CipherEngine *engine, const char *input,
+                            char *output, size_t length);
+
+/**
+ * @brief Encodes ${length} bytes of input into output, as if they were at the
+ * given position of a longer buffer. Only a key schedule depends on the
+ * position, which lets chunks of a buffer be encoded independently.
+ *
+ * @param engine initialized engine
+ * @param input bytes to encode
+ * @param output buffer to write the encoded bytes to
+ * @param length number of bytes to encode
+ * @param position position of the first byte in the whole buffer
+ */
+void cipher_engine_process_at (const CipherEngine *engine, const char *input,
+                               char *output, size_t length,
+                               unsigned long long position);
+
+/**
+ * @brief Encodes ${length} bytes in place using the original per-step loop.
+ * Kept as the reference implementation for benchmarks and correctness checks.
+ *
+ * @param buffer bytes to encode
+ * @param length number of bytes to encode
+ * @param k key to use
+ */
+void cipher_reference_process (char *buffer, size_t length, int k);
+
+#endif //CIPHER_ENGINE_H
@@ -0,0 +1,420 @@
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cipher.h"
+#include "cipher_engine.h"
+#include "cipher_fuzz.h"
+#include "cipher_keyed.h"
+#include "cipher_parallel.h"
+#include "cipher_stream.h"
+
+#define FUZZ_MAX_LENGTH 4096
+#define FUZZ_MAX_KEYS 40
+#define FUZZ_THREADS 3
+#define FUZZ_MAX_POSITION 100000
+
+// Shrinking stops after this many attempts, as each one re-runs the case.
+#define FUZZ_MAX_SHRINK_ATTEMPTS 2000
+
+// Large chunks are removed in whole vectors, so the bytes that follow keep
+// their alignment and the failure usually stays in the same lanes.
+#define FUZZ_SHRINK_ALIGNMENT 64
+
+// Every so often a case is large enough to be split between threads.
+#define FUZZ_LARGE_INTERVAL 500
+#define FUZZ_LARGE_LENGTH (CIPHER_PARALLEL_MIN_LENGTH + 12345)
+
+typedef enum FuzzKernel
+{
+  FUZZ_TABLE,
+  FUZZ_SSE2,
+  FUZZ_AVX2,
+  FUZZ_ENCODE,
+  FUZZ_DECODE,
+  FUZZ_STREAM,
+  FUZZ_PARALLEL,
+  FUZZ_KEYED,
+  FUZZ_KEYED_UNIFORM,
+  FUZZ_KERNEL_COUNT
+} FuzzKernel;
+
+/**
+ * A single random case: a buffer, a key and, for key schedules, the keys and
+ * the position of the buffer inside the whole stream.
+ */
+typedef struct FuzzCase
+{
+  char *buffer;
+  size_t length;
+  int k;
+  int keys[FUZZ_MAX_KEYS];
+  size_t key_count;
+  unsigned long long position;
+} FuzzCase;
+
+static const char *kernel_names[FUZZ_KERNEL_COUNT]
+    = { "table",  "sse2",     "avx2",  "encode",       "decode",
+        "stream", "parallel", "keyed", "keyed-uniform" };
+
+static uint64_t next_random (uint64_t *state);
+static int random_key (uint64_t *state);
+static void generate_case (FuzzCase *fuzz_case, uint64_t *state,
+                           unsigned long iteration);
+static int is_kernel_supported (FuzzKernel kernel);
+static int kernel_matches (FuzzKernel kernel, const FuzzCase *fuzz_case);
+static void compute_expected (FuzzKernel kernel, const FuzzCase *fuzz_case,
+                              char *expected);
+static int compute_actual (FuzzKernel kernel, const FuzzCase *fuzz_case,
+                           char *actual);
+static void minimize_case (FuzzKernel kernel, FuzzCase *fuzz_case);
+static void print_case (FuzzKernel kernel, const FuzzCase *fuzz_case);
+
+int run_fuzz (unsigned long iterations, unsigned int seed)
+{
+  FuzzCase fuzz_case;
+  fuzz_case.buffer = malloc (FUZZ_LARGE_LENGTH);
+  if (fuzz_case.buffer == NULL)
+  {
+    fprintf (stderr, "Failed to allocate the fuzzing buffer.\n");
+    return EXIT_FAILURE;
+  }
+
+  uint64_t state = (uint64_t) seed * 2654435761u + 1;
+
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    generate_case (&fuzz_case, &state, i);
+
+    for (int kernel = 0; kernel < FUZZ_KERNEL_COUNT; kernel++)
+    {
+      if (!is_kernel_supported (kernel)
+          || kernel_matches (kernel, &fuzz_case))
+      {
+        continue;
+      }
+
+      printf ("MISMATCH at iteration %lu (seed %u)\n", i, seed);
+      minimize_case (kernel, &fuzz_case);
+      print_case (kernel, &fuzz_case);
+
+      free (fuzz_case.buffer);
+      return EXIT_FAILURE;
+    }
+  }
+
+  printf ("All %lu cases matched the reference.\n", iterations);
+
+  free (fuzz_case.buffer);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief xorshift64 - returns the next random number of the given state.
+ */
+static uint64_t next_random (uint64_t *state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+/**
+ * @brief Draws a key, favouring the edge cases of k % ALPHABET_SIZE.
+ */
+static int random_key (uint64_t *state)
+{
+  switch (next_random (state) % 6)
+  {
+  case 0:
+    return (int) (next_random (state) % (4 * ALPHABET_SIZE + 1))
+           - (2 * ALPHABET_SIZE);
+  case 1:
+    return INT_MAX - (int) (next_random (state) % ALPHABET_SIZE);
+  case 2:
+    return INT_MIN + (int) (next_random (state) % ALPHABET_SIZE);
+  case 3:
+    return ALPHABET_SIZE * (int) (next_random (state) % 1000);
+  default:
+    return (int) (uint32_t) next_random (state);
+  }
+}
+
+/**
+ * @brief Fills the given case with a random buffer, key and key schedule.
+ */
+static void generate_case (FuzzCase *fuzz_case, uint64_t *state,
+                           unsigned long iteration)
+{
+  fuzz_case->length = (iteration % FUZZ_LARGE_INTERVAL == 0)
+                          ? FUZZ_LARGE_LENGTH
+                          : next_random (state) % (FUZZ_MAX_LENGTH + 1);
+
+  // Half of the cases are mostly letters, the rest are any byte at all.
+  int text = next_random (state) % 2;
+  for (size_t i = 0; i < fuzz_case->length; i++)
+  {
+    uint64_t r = next_random (state);
+    int letter = ((r % 2) ? 'a' : 'A') + (int) ((r >> 16) % 26);
+    fuzz_case->buffer[i]
+        = (char) ((text && (r >> 8) % 4 != 0) ? letter : (int) (r >> 24));
+  }
+
+  fuzz_case->k = random_key (state);
+  fuzz_case->key_count = 1 + next_random (state) % FUZZ_MAX_KEYS;
+  for (size_t i = 0; i < fuzz_case->key_count; i++)
+  {
+    fuzz_case->keys[i] = random_key (state);
+  }
+  fuzz_case->position = next_random (state) % FUZZ_MAX_POSITION;
+}
+
+static int is_kernel_supported (FuzzKernel kernel)
+{
+  if (kernel == FUZZ_SSE2)
+  {
+    return cipher_path_supported (CIPHER_PATH_SSE2);
+  }
+  if (kernel == FUZZ_AVX2)
+  {
+    return cipher_path_supported (CIPHER_PATH_AVX2);
+  }
+
+  return 1;
+}
+
+/**
+ * @brief Checks whether the given kernel matches the reference on the case.
+ *
+ * @return 1 if the outputs are identical, 0 otherwise (or if allocation
+ *         failed, which is reported as well)
+ */
+static int kernel_matches (FuzzKernel kernel, const FuzzCase *fuzz_case)
+{
+  // Allocating at least a byte, so empty cases have valid buffers too.
+  char *expected = malloc (fuzz_case->length + 1);
+  char *actual = malloc (fuzz_case->length + 1);
+
+  int result = expected != NULL && actual != NULL;
+  if (result)
+  {
+    compute_expected (kernel, fuzz_case, expected);
+    result = compute_actual (kernel, fuzz_case, actual) == 0
+             && memcmp (expected, actual, fuzz_case->length) == 0;
+  }
+
+  free (expected);
+  free (actual);
+
+  return result;
+}
+
+/**
+ * @brief Encodes the case with the reference loop, byte by byte for key
+ * schedules.
+ */
+static void compute_expected (FuzzKernel kernel, const FuzzCase *fuzz_case,
+                              char *expected)
+{
+  memcpy (expected, fuzz_case->buffer, fuzz_case->length);
+
+  if (kernel == FUZZ_DECODE)
+  {
+    // Decoding is checked as the inverse of encoding - it restores the input.
+    return;
+  }
+
+  if (kernel != FUZZ_KEYED)
+  {
+    cipher_reference_process (expected, fuzz_case->length, fuzz_case->k);
+    return;
+  }
+
+  for (size_t i = 0; i < fuzz_case->length; i++)
+  {
+    int k = fuzz_case->keys[(fuzz_case->position + i) % fuzz_case->key_count];
+    cipher_reference_process (expected + i, 1, k);
+  }
+}
+
+/**
+ * @brief Encodes the case with the given optimized kernel.
+ *
+ * @return 0 upon success, 1 if the kernel failed
+ */
+static int compute_actual (FuzzKernel kernel, const FuzzCase *fuzz_case,
+                           char *actual)
+{
+  size_t length = fuzz_case->length;
+  memcpy (actual, fuzz_case->buffer, length);
+
+  CipherEngine engine;
+  cipher_engine_init (&engine, fuzz_case->k);
+
+  switch (kernel)
+  {
+  case FUZZ_TABLE:
+  case FUZZ_SSE2:
+  case FUZZ_AVX2:
+    engine.path = (kernel == FUZZ_TABLE)  ? CIPHER_PATH_SCALAR
+                  : (kernel == FUZZ_SSE2) ? CIPHER_PATH_SSE2
+                                          : CIPHER_PATH_AVX2;
+    cipher_engine_process (&engine, actual, actual, length);
+    return 0;
+
+  case FUZZ_ENCODE:
+  case FUZZ_DECODE:
+    // encode/decode stop at the first NUL, so every NUL-terminated piece
+    // is transformed on its own.
+    actual[length] = '\0';
+    for (size_t i = 0; i < length; i += strlen (actual + i) + 1)
+    {
+      encode (actual + i, fuzz_case->k);
+      if (kernel == FUZZ_DECODE)
+      {
+        decode (actual + i, fuzz_case->k);
+      }
+    }
+    return 0;
+
+  case FUZZ_STREAM:
+  {
+    // Feeding the stream in uneven chunks, alternating in place and not.
+    CipherStream stream;
+    cipher_stream_init (&stream, fuzz_case->k, CIPHER_ENCODE);
+
+    size_t offset = 0, chunk = 1;
+    while (offset < length)
+    {
+      size_t size = (chunk < length - offset) ? chunk : length - offset;
+      int failed = (chunk % 2)
+                       ? cipher_stream_process (&stream, actual + offset, size)
+                       : cipher_stream_process_into (
+                           &stream, fuzz_case->buffer + offset,
+                           actual + offset, size);
+      if (failed)
+      {
+        return 1;
+      }
+      offset += size;
+      chunk = chunk * 3 + 1;
+    }
+
+    return cipher_stream_finalize (&stream) != length;
+  }
+
+  case FUZZ_PARALLEL:
+    cipher_parallel_process (&engine, fuzz_case->buffer, actual, length,
+                             FUZZ_THREADS);
+    return 0;
+
+  case FUZZ_KEYED:
+  case FUZZ_KEYED_UNIFORM:
+  {
+    // A schedule repeating the same key must match the single key.
+    int uniform[FUZZ_MAX_KEYS];
+    for (size_t i = 0; i < fuzz_case->key_count; i++)
+    {
+      uniform[i] = fuzz_case->k;
+    }
+
+    const int *keys = (kernel == FUZZ_KEYED) ? fuzz_case->keys : uniform;
+    if (cipher_engine_init_keyed (&engine, keys, fuzz_case->key_count) != 0)
+    {
+      return 1;
+    }
+
+    cipher_engine_process_at (&engine, actual, actual, length,
+                              fuzz_case->position);
+    cipher_engine_free (&engine);
+    return 0;
+  }
+
+  default:
+    return 1;
+  }
+}
+
+/**
+ * @brief Shrinks the failing case while it keeps failing: first by removing
+ * ever smaller chunks of the buffer, then by trying smaller keys with the
+ * same remainder. Removing a leading chunk moves the position forward, so
+ * the remaining bytes keep their keys.
+ */
+static void minimize_case (FuzzKernel kernel, FuzzCase *fuzz_case)
+{
+  int attempts = 0;
+
+  for (size_t chunk = fuzz_case->length / 2; chunk > 0; chunk /= 2)
+  {
+    if (chunk >= FUZZ_SHRINK_ALIGNMENT)
+    {
+      chunk -= chunk % FUZZ_SHRINK_ALIGNMENT;
+    }
+
+    size_t start = 0;
+    while (start + chunk <= fuzz_case->length
+           && attempts++ < FUZZ_MAX_SHRINK_ATTEMPTS)
+    {
+      char *removed = malloc (chunk);
+      if (removed == NULL)
+      {
+        return;
+      }
+
+      memcpy (removed, fuzz_case->buffer + start, chunk);
+      memmove (fuzz_case->buffer + start, fuzz_case->buffer + start + chunk,
+               fuzz_case->length - start - chunk);
+      fuzz_case->length -= chunk;
+      fuzz_case->position += (start == 0) ? chunk : 0;
+
+      if (kernel_matches (kernel, fuzz_case))
+      {
+        // Still needed for the failure - restoring it and moving on.
+        memmove (fuzz_case->buffer + start + chunk, fuzz_case->buffer + start,
+                 fuzz_case->length - start);
+        memcpy (fuzz_case->buffer + start, removed, chunk);
+        fuzz_case->length += chunk;
+        fuzz_case->position -= (start == 0) ? chunk : 0;
+        start += chunk;
+      }
+
+      free (removed);
+    }
+  }
+
+  int original_k = fuzz_case->k;
+  fuzz_case->k = original_k % ALPHABET_SIZE;
+  if (kernel_matches (kernel, fuzz_case))
+  {
+    fuzz_case->k = original_k;
+  }
+}
+
+/**
+ * @brief Prints the failing kernel and the reproducer as hex bytes.
+ */
+static void print_case (FuzzKernel kernel, const FuzzCase *fuzz_case)
+{
+  printf ("kernel: %s\nk: %d\n", kernel_names[kernel], fuzz_case->k);
+
+  if (kernel == FUZZ_KEYED || kernel == FUZZ_KEYED_UNIFORM)
+  {
+    printf ("position: %llu\nkeys:", fuzz_case->position);
+    for (size_t i = 0; i < fuzz_case->key_count; i++)
+    {
+      printf ("%s%d", i == 0 ? " " : ",", fuzz_case->keys[i]);
+    }
+    printf ("\n");
+  }
+
+  printf ("input (%zu bytes):", fuzz_case->length);
+  for (size_t i = 0; i < fuzz_case->length; i++)
+  {
+    printf (" %02x", (unsigned char) fuzz_case->buffer[i]);
+  }
+  printf ("\n");
+}
@@ -0,0 +1,19 @@
+#ifndef CIPHER_FUZZ_H
+#define CIPHER_FUZZ_H
+
+#define FUZZ_DEFAULT_ITERATIONS 2000
+
+/**
+ * Differential fuzzing of every optimized cipher path against the reference
+ * per-step loop. Each iteration draws a random buffer (every byte value,
+ * including NUL) and a random key - small, huge, negative, INT_MIN and
+ * INT_MAX alike - and checks that every path encodes it exactly like the
+ * reference. The first mismatch is shrunk to a minimal reproducer, which is
+ * printed along with the failing path.
+ * @param iterations number of random cases to check.
+ * @param seed seed of the random cases, the same seed replays the same cases.
+ * @return 0 if all paths matched the reference, 1 otherwise.
+ */
+int run_fuzz (unsigned long iterations, unsigned int seed);
+
+#endif //CIPHER_FUZZ_H
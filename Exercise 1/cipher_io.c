@@ -0,0 +1,506 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cipher_io.h"
+#include "cipher_parallel.h"
+#include "cipher_uring.h"
+
+#define OUTPUT_FILE_MODE 0666
+
+typedef struct PositionalTask
+{
+  const CipherEngine *engine;
+  int input_fd, output_fd;
+  off_t offset;
+  size_t length, block_size;
+  CipherIoStatus status;
+} PositionalTask;
+
+static CipherIoStatus transform_mapped (const CipherEngine *engine,
+                                        int input_fd, int output_fd,
+                                        size_t length, int threads);
+static CipherIoStatus open_files (const char *input_path,
+                                  const char *output_path, int *input_fd,
+                                  int *output_fd);
+static CipherIoStatus close_files (int input_fd, int output_fd,
+                                   CipherIoStatus status);
+static CipherIoStatus transform_stream (const CipherEngine *engine,
+                                        int input_fd, int output_fd,
+                                        size_t block_size);
+static CipherIoStatus transform_buffered (const CipherEngine *engine,
+                                          int input_fd, int output_fd,
+                                          char *buffer, size_t buffer_size);
+static CipherIoStatus transform_positional (const CipherEngine *engine,
+                                            int input_fd, int output_fd,
+                                            size_t length,
+                                            const CipherIoOptions *options);
+static void *transform_positional_chunk (void *arg);
+static int write_all (int fd, const char *buffer, size_t length);
+static int pwrite_all (int fd, const char *buffer, size_t length,
+                       off_t offset);
+
+void cipher_io_default_options (CipherIoOptions *options)
+{
+  options->mode = CIPHER_IO_MMAP;
+  options->block_size = CIPHER_IO_DEFAULT_BLOCK_SIZE;
+  options->threads = 1;
+  options->queue_depth = CIPHER_IO_DEFAULT_QUEUE_DEPTH;
+}
+
+CipherIoStatus cipher_io_transform_file (const CipherEngine *engine,
+                                         const char *input_path,
+                                         const char *output_path,
+                                         const CipherIoOptions *options)
+{
+  int input_fd, output_fd;
+  if (open_files (input_path, output_path, &input_fd, &output_fd)
+      != CIPHER_IO_SUCCESS)
+  {
+    return CIPHER_IO_FILE_ERROR;
+  }
+
+  struct stat input_stat, output_stat;
+  if (fstat (input_fd, &input_stat) != 0
+      || fstat (output_fd, &output_stat) != 0)
+  {
+    close (input_fd);
+    close (output_fd);
+    return CIPHER_IO_FILE_ERROR;
+  }
+
+  // Only regular files have a known size and can be mapped or split into
+  // chunks, and only a regular output can be sized up front and written out
+  // of order. Anything else (a pipe, a terminal) is streamed.
+  CipherIoStatus status = CIPHER_IO_FILE_ERROR;
+  int sized = S_ISREG (input_stat.st_mode)
+              && (uintmax_t) input_stat.st_size <= SIZE_MAX;
+  int positional = sized && S_ISREG (output_stat.st_mode);
+  int mappable = options->mode == CIPHER_IO_MMAP && positional;
+
+  int ringable = options->mode == CIPHER_IO_URING && positional;
+
+  if (mappable)
+  {
+    status = transform_mapped (engine, input_fd, output_fd,
+                               (size_t) input_stat.st_size, options->threads);
+  }
+  else if (ringable)
+  {
+    status = cipher_uring_transform (engine, input_fd, output_fd,
+                                     (size_t) input_stat.st_size,
+                                     options->block_size,
+                                     options->queue_depth);
+  }
+
+  int fallback = !(mappable || ringable) || status == CIPHER_IO_FILE_ERROR;
+  if (fallback && positional && (ringable || options->threads > 1))
+  {
+    status = transform_positional (engine, input_fd, output_fd,
+                                   (size_t) input_stat.st_size, options);
+  }
+  else if (fallback)
+  {
+    status = transform_stream (engine, input_fd, output_fd,
+                               options->block_size);
+  }
+
+  return close_files (input_fd, output_fd, status);
+}
+
+CipherIoStatus cipher_io_transform_buffered (const CipherEngine *engine,
+                                             const char *input_path,
+                                             const char *output_path,
+                                             char *buffer, size_t buffer_size)
+{
+  int input_fd, output_fd;
+  if (open_files (input_path, output_path, &input_fd, &output_fd)
+      != CIPHER_IO_SUCCESS)
+  {
+    return CIPHER_IO_FILE_ERROR;
+  }
+
+  CipherIoStatus status = transform_buffered (engine, input_fd, output_fd,
+                                              buffer, buffer_size);
+
+  return close_files (input_fd, output_fd, status);
+}
+
+const char *cipher_io_status_message (CipherIoStatus status)
+{
+  switch (status)
+  {
+  case CIPHER_IO_SUCCESS:
+    return "Success.";
+  case CIPHER_IO_FILE_ERROR:
+    return "The given file is invalid.";
+  case CIPHER_IO_READ_ERROR:
+    return "Failed to read the input file.";
+  case CIPHER_IO_WRITE_ERROR:
+    return "Failed to write the output file.";
+  default:
+    return "Failed to allocate memory.";
+  }
+}
+
+/**
+ * @brief Opens the input file for reading, and creates or truncates the
+ * output file for reading and writing.
+ *
+ * @param input_path path of the input file
+ * @param output_path path of the output file
+ * @param input_fd set to the opened input file
+ * @param output_fd set to the opened output file
+ * @return CIPHER_IO_SUCCESS if both files were opened, CIPHER_IO_FILE_ERROR
+ *         otherwise (and neither is left open)
+ */
+static CipherIoStatus open_files (const char *input_path,
+                                  const char *output_path, int *input_fd,
+                                  int *output_fd)
+{
+  *input_fd = open (input_path, O_RDONLY);
+  if (*input_fd < 0)
+  {
+    return CIPHER_IO_FILE_ERROR;
+  }
+
+  // Mapping the output needs it readable too, but a pipe opened for reading
+  // (like /dev/stdout) is its own reader, and would block our writes rather
+  // than fail them once the real reader is gone.
+  struct stat output_stat;
+  int access = (stat (output_path, &output_stat) == 0
+                && !S_ISREG (output_stat.st_mode))
+                   ? O_WRONLY
+                   : O_RDWR;
+
+  *output_fd = open (output_path, access | O_CREAT | O_TRUNC,
+                     OUTPUT_FILE_MODE);
+  if (*output_fd < 0)
+  {
+    close (*input_fd);
+    return CIPHER_IO_FILE_ERROR;
+  }
+
+  return CIPHER_IO_SUCCESS;
+}
+
+/**
+ * @brief Closes both files. Failing to close the output means some of it
+ * may not have been written.
+ *
+ * @param input_fd input file
+ * @param output_fd output file
+ * @param status status of the transform so far
+ * @return the given status, or CIPHER_IO_WRITE_ERROR if closing the output
+ *         failed
+ */
+static CipherIoStatus close_files (int input_fd, int output_fd,
+                                   CipherIoStatus status)
+{
+  close (input_fd);
+  if (close (output_fd) != 0 && status == CIPHER_IO_SUCCESS)
+  {
+    status = CIPHER_IO_WRITE_ERROR;
+  }
+
+  return status;
+}
+
+/**
+ * @brief Encodes the input mapping straight into the output mapping.
+ * If either file can't be mapped, nothing is written and CIPHER_IO_FILE_ERROR
+ * is returned so the caller can fall back to streaming.
+ *
+ * @param engine initialized engine
+ * @param input_fd input file, opened for reading
+ * @param output_fd output file, opened for reading and writing
+ * @param length size of the input file
+ * @param threads number of threads to encode with
+ * @return CIPHER_IO_SUCCESS if the file was transformed, an error otherwise
+ */
+static CipherIoStatus transform_mapped (const CipherEngine *engine,
+                                        int input_fd, int output_fd,
+                                        size_t length, int threads)
+{
+  // Mapping an empty file fails, but there's nothing to encode anyway.
+  if (length == 0)
+  {
+    return CIPHER_IO_SUCCESS;
+  }
+
+  char *input = mmap (NULL, length, PROT_READ, MAP_PRIVATE, input_fd, 0);
+  if (input == MAP_FAILED)
+  {
+    return CIPHER_IO_FILE_ERROR;
+  }
+  posix_madvise (input, length, POSIX_MADV_SEQUENTIAL);
+
+  if (ftruncate (output_fd, (off_t) length) != 0)
+  {
+    munmap (input, length);
+    return CIPHER_IO_WRITE_ERROR;
+  }
+
+  char *output = mmap (NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                       output_fd, 0);
+  if (output == MAP_FAILED)
+  {
+    munmap (input, length);
+    ftruncate (output_fd, 0);
+    return CIPHER_IO_FILE_ERROR;
+  }
+  posix_madvise (output, length, POSIX_MADV_SEQUENTIAL);
+
+  cipher_parallel_process (engine, input, output, length, threads);
+
+  munmap (input, length);
+  return munmap (output, length) == 0 ? CIPHER_IO_SUCCESS
+                                      : CIPHER_IO_WRITE_ERROR;
+}
+
+/**
+ * @brief Reads, encodes and writes the input in blocks of ${block_size}
+ * bytes through a single buffer.
+ *
+ * @param engine initialized engine
+ * @param input_fd input file, opened for reading
+ * @param output_fd output file, opened for writing
+ * @param block_size size of a single block
+ * @return CIPHER_IO_SUCCESS if the file was transformed, an error otherwise
+ */
+static CipherIoStatus transform_stream (const CipherEngine *engine,
+                                        int input_fd, int output_fd,
+                                        size_t block_size)
+{
+  char *buffer = malloc (block_size);
+  if (buffer == NULL)
+  {
+    return CIPHER_IO_ALLOCATION_ERROR;
+  }
+
+  CipherIoStatus status
+      = transform_buffered (engine, input_fd, output_fd, buffer, block_size);
+
+  free (buffer);
+  return status;
+}
+
+/**
+ * @brief Reads, encodes and writes the input through the given buffer.
+ *
+ * @param engine initialized engine
+ * @param input_fd input file, opened for reading
+ * @param output_fd output file, opened for writing
+ * @param buffer buffer to read each block into
+ * @param buffer_size size of the buffer
+ * @return CIPHER_IO_SUCCESS if the file was transformed, an error otherwise
+ */
+static CipherIoStatus transform_buffered (const CipherEngine *engine,
+                                          int input_fd, int output_fd,
+                                          char *buffer, size_t buffer_size)
+{
+  CipherIoStatus status = CIPHER_IO_SUCCESS;
+  unsigned long long position = 0;
+  while (status == CIPHER_IO_SUCCESS)
+  {
+    ssize_t length = read (input_fd, buffer, buffer_size);
+    if (length == 0)
+    {
+      break;
+    }
+    if (length < 0)
+    {
+      status = errno == EINTR ? CIPHER_IO_SUCCESS : CIPHER_IO_READ_ERROR;
+      continue;
+    }
+
+    cipher_engine_process_at (engine, buffer, buffer, (size_t) length,
+                              position);
+    position += (unsigned long long) length;
+
+    if (write_all (output_fd, buffer, (size_t) length) != 0)
+    {
+      status = CIPHER_IO_WRITE_ERROR;
+    }
+  }
+
+  return status;
+}
+
+/**
+ * @brief Splits the input into one chunk per thread. Each thread reads,
+ * encodes and writes its chunk in blocks, at the chunk's own offsets.
+ *
+ * @param engine initialized engine
+ * @param input_fd input file, opened for reading
+ * @param output_fd output file, opened for writing
+ * @param length size of the input file
+ * @param options number of threads and size of a single block
+ * @return CIPHER_IO_SUCCESS if the file was transformed, an error otherwise
+ */
+static CipherIoStatus transform_positional (const CipherEngine *engine,
+                                            int input_fd, int output_fd,
+                                            size_t length,
+                                            const CipherIoOptions *options)
+{
+  // Sizing the output up front, so chunks can be written in any order.
+  if (ftruncate (output_fd, (off_t) length) != 0)
+  {
+    return CIPHER_IO_WRITE_ERROR;
+  }
+
+  size_t chunk_size;
+  int count = cipher_parallel_chunks (length, options->threads, &chunk_size);
+
+  PositionalTask *tasks = malloc (sizeof (PositionalTask) * count);
+  if (tasks == NULL)
+  {
+    return CIPHER_IO_ALLOCATION_ERROR;
+  }
+
+  for (int i = 0; i < count; i++)
+  {
+    size_t offset = i * chunk_size;
+    tasks[i] = (PositionalTask) {
+      .engine = engine,
+      .input_fd = input_fd,
+      .output_fd = output_fd,
+      .offset = (off_t) offset,
+      .length = (i == count - 1) ? (length - offset) : chunk_size,
+      .block_size = options->block_size,
+      .status = CIPHER_IO_SUCCESS
+    };
+  }
+
+  cipher_parallel_run (&transform_positional_chunk, tasks,
+                       sizeof (PositionalTask), count);
+
+  CipherIoStatus status = CIPHER_IO_SUCCESS;
+  for (int i = 0; i < count && status == CIPHER_IO_SUCCESS; i++)
+  {
+    status = tasks[i].status;
+  }
+
+  free (tasks);
+  return status;
+}
+
+/**
+ * @brief Transforms a single chunk of the input with positional I/O.
+ *
+ * @param arg pointer to the chunk's PositionalTask, its status is updated
+ * @return NULL
+ */
+static void *transform_positional_chunk (void *arg)
+{
+  PositionalTask *task = arg;
+
+  char *buffer = malloc (task->block_size);
+  if (buffer == NULL)
+  {
+    task->status = CIPHER_IO_ALLOCATION_ERROR;
+    return NULL;
+  }
+
+  off_t offset = task->offset;
+  size_t remaining = task->length;
+
+  while (remaining > 0 && task->status == CIPHER_IO_SUCCESS)
+  {
+    size_t wanted = remaining < task->block_size ? remaining : task->block_size;
+
+    ssize_t length = pread (task->input_fd, buffer, wanted, offset);
+    if (length < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (length <= 0)
+    {
+      // The file shrank while we were reading it
+      task->status = CIPHER_IO_READ_ERROR;
+      continue;
+    }
+
+    cipher_engine_process_at (task->engine, buffer, buffer, (size_t) length,
+                              (unsigned long long) offset);
+
+    if (pwrite_all (task->output_fd, buffer, (size_t) length, offset) != 0)
+    {
+      task->status = CIPHER_IO_WRITE_ERROR;
+    }
+
+    offset += length;
+    remaining -= (size_t) length;
+  }
+
+  free (buffer);
+  return NULL;
+}
+
+/**
+ * @brief Writes the whole buffer, retrying partial and interrupted writes.
+ *
+ * @param fd file to write to
+ * @param buffer bytes to write
+ * @param length number of bytes to write
+ * @return 0 upon success, 1 otherwise
+ */
+static int write_all (int fd, const char *buffer, size_t length)
+{
+  while (length > 0)
+  {
+    ssize_t written = write (fd, buffer, length);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return 1;
+    }
+
+    buffer += written;
+    length -= (size_t) written;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Writes the whole buffer at the given offset, retrying partial and
+ * interrupted writes.
+ *
+ * @param fd file to write to
+ * @param buffer bytes to write
+ * @param length number of bytes to write
+ * @param offset offset in the file to write at
+ * @return 0 upon success, 1 otherwise
+ */
+static int pwrite_all (int fd, const char *buffer, size_t length,
+                       off_t offset)
+{
+  while (length > 0)
+  {
+    ssize_t written = pwrite (fd, buffer, length, offset);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return 1;
+    }
+
+    buffer += written;
+    offset += written;
+    length -= (size_t) written;
+  }
+
+  return 0;
+}
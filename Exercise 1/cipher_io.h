@@ -0,0 +1,99 @@
+#ifndef CIPHER_IO_H
+#define CIPHER_IO_H
+
+#include <stddef.h>
+
+#include "cipher_engine.h"
+
+#define CIPHER_IO_DEFAULT_BLOCK_SIZE (1024 * 1024)
+#define CIPHER_IO_DEFAULT_QUEUE_DEPTH 8
+
+/**
+ * The ways a file can be transformed.
+ * CIPHER_IO_MMAP maps both files and encodes straight from one mapping to the
+ * other, falling back to streaming when either file can't be mapped (pipes,
+ * terminals, character devices).
+ * CIPHER_IO_STREAM reads, encodes and writes large blocks through a single
+ * reused buffer.
+ * CIPHER_IO_URING keeps ${queue_depth} blocks of a regular file in flight over
+ * io_uring, encoding each block as soon as it's read while the others are
+ * still being read or written. Without io_uring it falls back to positional
+ * I/O, and like mmap it streams anything that isn't a regular file.
+ * With more than one thread, a regular input file written to a regular output
+ * file is split into independent chunks that are encoded in parallel - mapped
+ * chunks are encoded in place, streamed chunks are read and written back at
+ * their own offsets with positional I/O. The output is byte-identical either
+ * way.
+ */
+typedef enum CipherIoMode
+{
+  CIPHER_IO_MMAP,
+  CIPHER_IO_STREAM,
+  CIPHER_IO_URING
+} CipherIoMode;
+
+typedef enum CipherIoStatus
+{
+  CIPHER_IO_SUCCESS,
+  CIPHER_IO_FILE_ERROR,
+  CIPHER_IO_READ_ERROR,
+  CIPHER_IO_WRITE_ERROR,
+  CIPHER_IO_ALLOCATION_ERROR
+} CipherIoStatus;
+
+typedef struct CipherIoOptions
+{
+  CipherIoMode mode;
+  size_t block_size; // Size of a single streamed block, in bytes
+  int threads;
+  int queue_depth; // Number of blocks in flight with CIPHER_IO_URING
+} CipherIoOptions;
+
+/**
+ * @brief Fills the given options with the default values.
+ *
+ * @param options options to fill
+ */
+void cipher_io_default_options (CipherIoOptions *options);
+
+/**
+ * @brief Encodes the whole input file into the output file with the given
+ * engine. The files are treated as raw bytes - there is no line parsing, so
+ * very long lines, missing newlines and NUL bytes are all handled the same.
+ *
+ * @param engine initialized engine
+ * @param input_path path of the input file
+ * @param output_path path of the output file, created or truncated
+ * @param options how to transform the file
+ * @return CIPHER_IO_SUCCESS if the file was transformed, an error otherwise
+ */
+CipherIoStatus cipher_io_transform_file (const CipherEngine *engine,
+                                         const char *input_path,
+                                         const char *output_path,
+                                         const CipherIoOptions *options);
+
+/**
+ * @brief Encodes the whole input file into the output file through the
+ * caller's buffer, without allocating or mapping anything. Meant for many
+ * small files, where a single buffer is reused across files.
+ *
+ * @param engine initialized engine
+ * @param input_path path of the input file
+ * @param output_path path of the output file, created or truncated
+ * @param buffer buffer to stream the file through
+ * @param buffer_size size of the buffer
+ * @return CIPHER_IO_SUCCESS if the file was transformed, an error otherwise
+ */
+CipherIoStatus cipher_io_transform_buffered (const CipherEngine *engine,
+                                             const char *input_path,
+                                             const char *output_path,
+                                             char *buffer, size_t buffer_size);
+
+/**
+ * @brief Returns a message describing the given status.
+ *
+ * @param status status to describe
+ */
+const char *cipher_io_status_message (CipherIoStatus status);
+
+#endif //CIPHER_IO_H
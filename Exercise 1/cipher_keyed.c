@@ -0,0 +1,43 @@
+#include <string.h>
+
+#include "cipher_engine.h"
+#include "cipher_keyed.h"
+
+/**
+ * @brief Encodes or decodes the given string with the given key schedule.
+ *
+ * @param s string to transform
+ * @param keys keys to use
+ * @param key_count number of keys
+ * @param decode whether to decode rather than encode
+ * @return 0 upon success, 1 otherwise
+ */
+static int transform_keyed (char s[], const int keys[], size_t key_count,
+                            int decode)
+{
+  CipherEngine engine;
+  if (cipher_engine_init_keyed (&engine, keys, key_count) != 0)
+  {
+    return 1;
+  }
+
+  if (decode)
+  {
+    cipher_engine_invert (&engine);
+  }
+
+  cipher_engine_process (&engine, s, s, strlen (s));
+  cipher_engine_free (&engine);
+
+  return 0;
+}
+
+int encode_keyed (char s[], const int keys[], size_t key_count)
+{
+  return transform_keyed (s, keys, key_count, 0);
+}
+
+int decode_keyed (char s[], const int keys[], size_t key_count)
+{
+  return transform_keyed (s, keys, key_count, 1);
+}
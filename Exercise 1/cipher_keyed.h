@@ -0,0 +1,26 @@
+#ifndef CIPHER_KEYED_H
+#define CIPHER_KEYED_H
+
+#include <stddef.h>
+
+/**
+ * Encodes the given string with a repeating key schedule (a vigenere cipher):
+ * the character at index i is shifted by keys[i % key_count], following the
+ * same alphabet rules as encode.
+ * @param s - given string.
+ * @param keys - given shift values.
+ * @param key_count - number of shift values, between 1 and CIPHER_MAX_KEYS.
+ * @return 0 upon success, 1 if the keys are invalid or allocation failed.
+ */
+int encode_keyed (char s[], const int keys[], size_t key_count);
+
+/**
+ * Decodes the given string with a repeating key schedule.
+ * @param s - given string.
+ * @param keys - given shift values.
+ * @param key_count - number of shift values, between 1 and CIPHER_MAX_KEYS.
+ * @return 0 upon success, 1 if the keys are invalid or allocation failed.
+ */
+int decode_keyed (char s[], const int keys[], size_t key_count);
+
+#endif //CIPHER_KEYED_H
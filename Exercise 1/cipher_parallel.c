@@ -0,0 +1,123 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "cipher_parallel.h"
+
+typedef struct ChunkTask
+{
+  const CipherEngine *engine;
+  const char *input;
+  char *output;
+  size_t length;
+  unsigned long long position;
+} ChunkTask;
+
+static void *process_chunk (void *arg);
+
+void cipher_parallel_run (cipher_worker worker, void *tasks, size_t task_size,
+                          int count)
+{
+  if (count <= 0)
+  {
+    return;
+  }
+
+  pthread_t *threads = malloc (sizeof (pthread_t) * count);
+  char *created = calloc (count, sizeof (char));
+
+  // Without memory for the thread handles, all tasks run on this thread.
+  for (int i = 0; i < count - 1; i++)
+  {
+    void *task = (char *) tasks + (i * task_size);
+
+    if (threads != NULL && created != NULL
+        && pthread_create (&threads[i], NULL, worker, task) == 0)
+    {
+      created[i] = 1;
+    }
+    else
+    {
+      worker (task);
+    }
+  }
+
+  worker ((char *) tasks + ((count - 1) * task_size));
+
+  for (int i = 0; i < count - 1 && threads != NULL && created != NULL; i++)
+  {
+    if (created[i])
+    {
+      pthread_join (threads[i], NULL);
+    }
+  }
+
+  free (threads);
+  free (created);
+}
+
+int cipher_parallel_chunks (size_t length, int threads, size_t *chunk_size)
+{
+  if (threads < 1)
+  {
+    threads = 1;
+  }
+  if (threads > CIPHER_MAX_THREADS)
+  {
+    threads = CIPHER_MAX_THREADS;
+  }
+
+  size_t size = (length + threads - 1) / threads;
+  size = ((size + CIPHER_CHUNK_ALIGNMENT - 1) / CIPHER_CHUNK_ALIGNMENT)
+         * CIPHER_CHUNK_ALIGNMENT;
+
+  *chunk_size = size;
+  return length == 0 ? 1 : (int) ((length + size - 1) / size);
+}
+
+void cipher_parallel_process (const CipherEngine *engine, const char *input,
+                              char *output, size_t length, int threads)
+{
+  if (threads <= 1 || length < CIPHER_PARALLEL_MIN_LENGTH)
+  {
+    cipher_engine_process (engine, input, output, length);
+    return;
+  }
+
+  size_t chunk_size;
+  int count = cipher_parallel_chunks (length, threads, &chunk_size);
+
+  ChunkTask *tasks = malloc (sizeof (ChunkTask) * count);
+  if (tasks == NULL)
+  {
+    cipher_engine_process (engine, input, output, length);
+    return;
+  }
+
+  for (int i = 0; i < count; i++)
+  {
+    size_t offset = i * chunk_size;
+    tasks[i].engine = engine;
+    tasks[i].input = input + offset;
+    tasks[i].output = output + offset;
+    tasks[i].length
+        = (i == count - 1) ? (length - offset) : chunk_size;
+    tasks[i].position = offset;
+  }
+
+  cipher_parallel_run (&process_chunk, tasks, sizeof (ChunkTask), count);
+  free (tasks);
+}
+
+/**
+ * @brief Encodes a single chunk of a buffer.
+ *
+ * @param arg pointer to the chunk's ChunkTask
+ * @return NULL
+ */
+static void *process_chunk (void *arg)
+{
+  ChunkTask *task = arg;
+  cipher_engine_process_at (task->engine, task->input, task->output,
+                            task->length, task->position);
+  return NULL;
+}
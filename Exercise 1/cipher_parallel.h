@@ -0,0 +1,56 @@
+#ifndef CIPHER_PARALLEL_H
+#define CIPHER_PARALLEL_H
+
+#include <stddef.h>
+
+#include "cipher_engine.h"
+
+#define CIPHER_MAX_THREADS 256
+
+// Chunks are aligned to pages, so threads never share a page of the output.
+#define CIPHER_CHUNK_ALIGNMENT 4096
+
+// Below this size, spawning threads costs more than encoding.
+#define CIPHER_PARALLEL_MIN_LENGTH (1024 * 1024)
+
+typedef void *(*cipher_worker) (void *);
+
+/**
+ * @brief Runs the worker once per task, each on its own thread, and waits for
+ * all of them to finish. The last task runs on the calling thread, and tasks
+ * whose thread couldn't be created run on the calling thread as well.
+ *
+ * @param worker function to run, receives a pointer to its task
+ * @param tasks array of tasks
+ * @param task_size size of a single task, in bytes
+ * @param count number of tasks
+ */
+void cipher_parallel_run (cipher_worker worker, void *tasks, size_t task_size,
+                          int count);
+
+/**
+ * @brief Returns the number of chunks ${length} bytes should be split into
+ * for ${threads} threads, and the (aligned) size of each chunk but the last.
+ *
+ * @param length number of bytes to split
+ * @param threads number of threads requested
+ * @param chunk_size set to the size of a single chunk
+ * @return number of chunks, at least 1
+ */
+int cipher_parallel_chunks (size_t length, int threads, size_t *chunk_size);
+
+/**
+ * @brief Encodes ${length} bytes of input into output, splitting the buffer
+ * into independent chunks that are encoded on ${threads} threads.
+ * The output is byte-identical to cipher_engine_process.
+ *
+ * @param engine initialized engine
+ * @param input bytes to encode
+ * @param output buffer to write the encoded bytes to
+ * @param length number of bytes to encode
+ * @param threads number of threads to use
+ */
+void cipher_parallel_process (const CipherEngine *engine, const char *input,
+                              char *output, size_t length, int threads);
+
+#endif //CIPHER_PARALLEL_H
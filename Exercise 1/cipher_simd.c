@@ -0,0 +1,216 @@
+#include "cipher_simd.h"
+#include "cipher_engine.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CIPHER_X86 1
+#include <immintrin.h>
+#endif
+
+#define SSE2_WIDTH 16
+#define AVX2_WIDTH 32
+#define CASE_BIT 0x20
+
+/*
+  All kernels rotate both alphabets at once:
+  Setting the case bit folds 'A'-'Z' onto 'a'-'z', so a byte is a letter iff
+  (c | 0x20) - 'a' is in [0, 25] as an unsigned byte. A letter is then moved by
+  shift, or by shift - 26 if that would pass the end of the alphabet. Every
+  other byte is moved by 0.
+  There are no unsigned byte comparisons, so x <= 25 is checked as
+  min(x, 25) == x.
+  Keyed kernels do the same with a different shift per lane, loaded from the
+  unrolled key schedule at the current phase.
+*/
+
+#ifdef CIPHER_X86
+
+int cipher_simd_has_sse2 (void)
+{
+  __builtin_cpu_init ();
+  return __builtin_cpu_supports ("sse2");
+}
+
+int cipher_simd_has_avx2 (void)
+{
+  __builtin_cpu_init ();
+  return __builtin_cpu_supports ("avx2");
+}
+
+/**
+ * @brief Rotates the letters of 16 bytes, each by its own lane's shift.
+ *
+ * @param c bytes to rotate
+ * @param shifts shift of every lane, in [0, 26)
+ * @return the rotated bytes
+ */
+__attribute__ ((target ("sse2"))) static inline __m128i
+rotate_sse2 (__m128i c, __m128i shifts)
+{
+  const __m128i case_bit = _mm_set1_epi8 (CASE_BIT);
+  const __m128i lower_start = _mm_set1_epi8 (ALPHABET_LOWER_START);
+  const __m128i last = _mm_set1_epi8 (ALPHABET_SINGLE_SIZE - 1);
+  const __m128i size = _mm_set1_epi8 (ALPHABET_SINGLE_SIZE);
+
+  __m128i offset = _mm_sub_epi8 (_mm_or_si128 (c, case_bit), lower_start);
+  __m128i is_letter = _mm_cmpeq_epi8 (_mm_min_epu8 (offset, last), offset);
+
+  __m128i shifted = _mm_add_epi8 (offset, shifts);
+  __m128i in_range = _mm_cmpeq_epi8 (_mm_min_epu8 (shifted, last), shifted);
+  __m128i delta = _mm_sub_epi8 (shifts, _mm_andnot_si128 (in_range, size));
+
+  return _mm_add_epi8 (c, _mm_and_si128 (is_letter, delta));
+}
+
+/**
+ * @brief Rotates the letters of 32 bytes, each by its own lane's shift.
+ *
+ * @param c bytes to rotate
+ * @param shifts shift of every lane, in [0, 26)
+ * @return the rotated bytes
+ */
+__attribute__ ((target ("avx2"))) static inline __m256i
+rotate_avx2 (__m256i c, __m256i shifts)
+{
+  const __m256i case_bit = _mm256_set1_epi8 (CASE_BIT);
+  const __m256i lower_start = _mm256_set1_epi8 (ALPHABET_LOWER_START);
+  const __m256i last = _mm256_set1_epi8 (ALPHABET_SINGLE_SIZE - 1);
+  const __m256i size = _mm256_set1_epi8 (ALPHABET_SINGLE_SIZE);
+
+  __m256i offset
+      = _mm256_sub_epi8 (_mm256_or_si256 (c, case_bit), lower_start);
+  __m256i is_letter
+      = _mm256_cmpeq_epi8 (_mm256_min_epu8 (offset, last), offset);
+
+  __m256i shifted = _mm256_add_epi8 (offset, shifts);
+  __m256i in_range
+      = _mm256_cmpeq_epi8 (_mm256_min_epu8 (shifted, last), shifted);
+  __m256i delta
+      = _mm256_sub_epi8 (shifts, _mm256_andnot_si256 (in_range, size));
+
+  return _mm256_add_epi8 (c, _mm256_and_si256 (is_letter, delta));
+}
+
+__attribute__ ((target ("sse2"))) size_t
+cipher_simd_process_sse2 (int shift, const unsigned char *input,
+                          unsigned char *output, size_t length)
+{
+  const __m128i shifts = _mm_set1_epi8 ((char) shift);
+
+  size_t i = 0;
+  for (; i + SSE2_WIDTH <= length; i += SSE2_WIDTH)
+  {
+    __m128i c = _mm_loadu_si128 ((const __m128i *) (input + i));
+    _mm_storeu_si128 ((__m128i *) (output + i), rotate_sse2 (c, shifts));
+  }
+
+  return i;
+}
+
+__attribute__ ((target ("avx2"))) size_t
+cipher_simd_process_avx2 (int shift, const unsigned char *input,
+                          unsigned char *output, size_t length)
+{
+  const __m256i shifts = _mm256_set1_epi8 ((char) shift);
+
+  size_t i = 0;
+  for (; i + AVX2_WIDTH <= length; i += AVX2_WIDTH)
+  {
+    __m256i c = _mm256_loadu_si256 ((const __m256i *) (input + i));
+    _mm256_storeu_si256 ((__m256i *) (output + i), rotate_avx2 (c, shifts));
+  }
+
+  return i;
+}
+
+__attribute__ ((target ("sse2"))) size_t
+cipher_simd_process_keyed_sse2 (const unsigned char *pattern, size_t period,
+                                size_t phase, const unsigned char *input,
+                                unsigned char *output, size_t length)
+{
+  // Both phase and step are below period, so a single subtraction wraps.
+  const size_t step = SSE2_WIDTH % period;
+
+  size_t i = 0;
+  for (; i + SSE2_WIDTH <= length; i += SSE2_WIDTH)
+  {
+    __m128i shifts = _mm_loadu_si128 ((const __m128i *) (pattern + phase));
+    __m128i c = _mm_loadu_si128 ((const __m128i *) (input + i));
+    _mm_storeu_si128 ((__m128i *) (output + i), rotate_sse2 (c, shifts));
+
+    phase += step;
+    phase = phase >= period ? phase - period : phase;
+  }
+
+  return i;
+}
+
+__attribute__ ((target ("avx2"))) size_t
+cipher_simd_process_keyed_avx2 (const unsigned char *pattern, size_t period,
+                                size_t phase, const unsigned char *input,
+                                unsigned char *output, size_t length)
+{
+  // Both phase and step are below period, so a single subtraction wraps.
+  const size_t step = AVX2_WIDTH % period;
+
+  size_t i = 0;
+  for (; i + AVX2_WIDTH <= length; i += AVX2_WIDTH)
+  {
+    __m256i shifts
+        = _mm256_loadu_si256 ((const __m256i *) (pattern + phase));
+    __m256i c = _mm256_loadu_si256 ((const __m256i *) (input + i));
+    _mm256_storeu_si256 ((__m256i *) (output + i), rotate_avx2 (c, shifts));
+
+    phase += step;
+    phase = phase >= period ? phase - period : phase;
+  }
+
+  return i;
+}
+
+#else
+
+int cipher_simd_has_sse2 (void)
+{
+  return 0;
+}
+
+int cipher_simd_has_avx2 (void)
+{
+  return 0;
+}
+
+size_t cipher_simd_process_sse2 (int shift, const unsigned char *input,
+                                 unsigned char *output, size_t length)
+{
+  (void) shift, (void) input, (void) output, (void) length;
+  return 0;
+}
+
+size_t cipher_simd_process_avx2 (int shift, const unsigned char *input,
+                                 unsigned char *output, size_t length)
+{
+  (void) shift, (void) input, (void) output, (void) length;
+  return 0;
+}
+
+size_t cipher_simd_process_keyed_sse2 (const unsigned char *pattern,
+                                       size_t period, size_t phase,
+                                       const unsigned char *input,
+                                       unsigned char *output, size_t length)
+{
+  (void) pattern, (void) period, (void) phase;
+  (void) input, (void) output, (void) length;
+  return 0;
+}
+
+size_t cipher_simd_process_keyed_avx2 (const unsigned char *pattern,
+                                       size_t period, size_t phase,
+                                       const unsigned char *input,
+                                       unsigned char *output, size_t length)
+{
+  (void) pattern, (void) period, (void) phase;
+  (void) input, (void) output, (void) length;
+  return 0;
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef CIPHER_SIMD_H
+#define CIPHER_SIMD_H
+
+#include <stddef.h>
+
+/**
+ * Vectorized caesar kernels.
+ * Each kernel encodes the longest prefix of the buffer that fits in whole
+ * vectors and returns its length, leaving the tail to the caller.
+ * Kernels are only available on x86 - elsewhere they encode nothing.
+ */
+
+/**
+ * @brief Checks whether the running CPU supports the SSE2 kernel.
+ */
+int cipher_simd_has_sse2 (void);
+
+/**
+ * @brief Checks whether the running CPU supports the AVX2 kernel.
+ */
+int cipher_simd_has_avx2 (void);
+
+/**
+ * @brief Encodes 16 bytes at a time with SSE2.
+ *
+ * @param shift effective shift inside a single alphabet, in [0, 26)
+ * @param input bytes to encode
+ * @param output buffer to write the encoded bytes to
+ * @param length number of bytes available
+ * @return number of bytes encoded
+ */
+size_t cipher_simd_process_sse2 (int shift, const unsigned char *input,
+                                 unsigned char *output, size_t length);
+
+/**
+ * @brief Encodes 32 bytes at a time with AVX2.
+ *
+ * @param shift effective shift inside a single alphabet, in [0, 26)
+ * @param input bytes to encode
+ * @param output buffer to write the encoded bytes to
+ * @param length number of bytes available
+ * @return number of bytes encoded
+ */
+size_t cipher_simd_process_avx2 (int shift, const unsigned char *input,
+                                 unsigned char *output, size_t length);
+
+/**
+ * @brief Encodes 16 bytes at a time with SSE2, shifting each byte by its
+ * position's key.
+ *
+ * @param pattern key schedule, unrolled CIPHER_PATTERN_PADDING bytes past
+ *                its period
+ * @param period number of keys in the schedule
+ * @param phase position of the first byte inside the schedule
+ * @param input bytes to encode
+ * @param output buffer to write the encoded bytes to
+ * @param length number of bytes available
+ * @return number of bytes encoded
+ */
+size_t cipher_simd_process_keyed_sse2 (const unsigned char *pattern,
+                                       size_t period, size_t phase,
+                                       const unsigned char *input,
+                                       unsigned char *output, size_t length);
+
+/**
+ * @brief Encodes 32 bytes at a time with AVX2, shifting each byte by its
+ * position's key.
+ *
+ * @param pattern key schedule, unrolled CIPHER_PATTERN_PADDING bytes past
+ *                its period
+ * @param period number of keys in the schedule
+ * @param phase position of the first byte inside the schedule
+ * @param input bytes to encode
+ * @param output buffer to write the encoded bytes to
+ * @param length number of bytes available
+ * @return number of bytes encoded
+ */
+size_t cipher_simd_process_keyed_avx2 (const unsigned char *pattern,
+                                       size_t period, size_t phase,
+                                       const unsigned char *input,
+                                       unsigned char *output, size_t length);
+
+#endif //CIPHER_SIMD_H
@@ -0,0 +1,37 @@
+#include "cipher_stream.h"
+
+void cipher_stream_init (CipherStream *stream, int k,
+                         CipherDirection direction)
+{
+  int key = (direction == CIPHER_ENCODE) ? k : cipher_decode_key (k);
+
+  cipher_engine_init (&stream->engine, key);
+  stream->processed = 0;
+  stream->finalized = 0;
+}
+
+int cipher_stream_process (CipherStream *stream, char *buffer, size_t length)
+{
+  return cipher_stream_process_into (stream, buffer, buffer, length);
+}
+
+int cipher_stream_process_into (CipherStream *stream, const char *input,
+                                char *output, size_t length)
+{
+  if (stream->finalized)
+  {
+    return 1;
+  }
+
+  cipher_engine_process_at (&stream->engine, input, output, length,
+                            stream->processed);
+  stream->processed += length;
+
+  return 0;
+}
+
+unsigned long long cipher_stream_finalize (CipherStream *stream)
+{
+  stream->finalized = 1;
+  return stream->processed;
+}
@@ -0,0 +1,70 @@
+#ifndef CIPHER_STREAM_H
+#define CIPHER_STREAM_H
+
+#include <stddef.h>
+
+#include "cipher_engine.h"
+
+/**
+ * An incremental cipher over a stream of raw bytes (a pipe, a socket).
+ * Buffers are binary-safe - they may hold NUL bytes and don't need to be
+ * NUL-terminated - and can be fed in chunks of any size, so the stream can
+ * be driven straight from the reads of the surrounding pipeline.
+ */
+
+typedef enum CipherDirection
+{
+  CIPHER_ENCODE,
+  CIPHER_DECODE
+} CipherDirection;
+
+typedef struct CipherStream
+{
+  CipherEngine engine;
+  unsigned long long processed; // Total number of bytes processed so far
+  int finalized;
+} CipherStream;
+
+/**
+ * @brief Prepares the given stream for encoding or decoding with the given
+ * key.
+ *
+ * @param stream stream to initialize
+ * @param k key to use
+ * @param direction whether to encode or decode
+ */
+void cipher_stream_init (CipherStream *stream, int k,
+                         CipherDirection direction);
+
+/**
+ * @brief Transforms the next ${length} bytes of the stream in place.
+ *
+ * @param stream initialized stream
+ * @param buffer bytes to transform
+ * @param length number of bytes to transform
+ * @return 0 upon success, 1 if the stream was already finalized
+ */
+int cipher_stream_process (CipherStream *stream, char *buffer, size_t length);
+
+/**
+ * @brief Transforms the next ${length} bytes of the stream into a separate
+ * output buffer. The input is left untouched.
+ *
+ * @param stream initialized stream
+ * @param input bytes to transform
+ * @param output buffer to write the transformed bytes to
+ * @param length number of bytes to transform
+ * @return 0 upon success, 1 if the stream was already finalized
+ */
+int cipher_stream_process_into (CipherStream *stream, const char *input,
+                                char *output, size_t length);
+
+/**
+ * @brief Ends the stream. Further calls to process fail.
+ *
+ * @param stream stream to finalize
+ * @return the total number of bytes processed by the stream
+ */
+unsigned long long cipher_stream_finalize (CipherStream *stream);
+
+#endif //CIPHER_STREAM_H
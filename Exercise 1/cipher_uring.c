@@ -0,0 +1,381 @@
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cipher_uring.h"
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) \
+    && defined(__NR_io_uring_enter)
+
+/**
+ * The shared rings of a single io_uring instance, mapped from the kernel.
+ * There's no liburing on every machine, so the rings are driven directly with
+ * the raw system calls.
+ */
+typedef struct Ring
+{
+  int fd;
+  void *sq_map, *cq_map;
+  size_t sq_map_size, cq_map_size;
+  struct io_uring_sqe *sqes;
+  size_t sqes_size;
+  unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_cqe *cqes;
+  unsigned sq_local_tail; // Tail of the submissions queued so far
+} Ring;
+
+/**
+ * A single block in flight. A slot is either reading its block or writing it
+ * back, and short reads and writes are resubmitted for the remainder.
+ */
+typedef struct Slot
+{
+  char *buffer;
+  off_t offset;
+  size_t length; // Number of bytes in the block
+  size_t done; // Number of bytes of the current read or write completed
+  int writing;
+  struct iovec iov;
+} Slot;
+
+static int ring_init (Ring *ring, unsigned entries);
+static void ring_free (Ring *ring);
+static void ring_queue (Ring *ring, Slot *slot, int input_fd, int output_fd);
+static int ring_enter (Ring *ring, unsigned wait);
+static void start_block (Slot *slot, off_t *next_offset, size_t length,
+                         size_t block_size);
+static CipherIoStatus run_ring (Ring *ring, Slot slots[], int slot_count,
+                                const CipherEngine *engine, int input_fd,
+                                int output_fd, size_t length,
+                                size_t block_size);
+
+CipherIoStatus cipher_uring_transform (const CipherEngine *engine,
+                                       int input_fd, int output_fd,
+                                       size_t length, size_t block_size,
+                                       int queue_depth)
+{
+  Ring ring;
+  if (ring_init (&ring, (unsigned) queue_depth) != 0)
+  {
+    return CIPHER_IO_FILE_ERROR;
+  }
+
+  // There's no point in more slots than blocks.
+  size_t block_count = (length + block_size - 1) / block_size;
+  int slot_count = (size_t) queue_depth < block_count ? queue_depth
+                                                      : (int) block_count;
+
+  Slot *slots = calloc (slot_count > 0 ? slot_count : 1, sizeof (Slot));
+  if (slots == NULL)
+  {
+    ring_free (&ring);
+    return CIPHER_IO_ALLOCATION_ERROR;
+  }
+
+  CipherIoStatus status = CIPHER_IO_SUCCESS;
+  for (int i = 0; i < slot_count && status == CIPHER_IO_SUCCESS; i++)
+  {
+    slots[i].buffer = malloc (block_size);
+    status = slots[i].buffer == NULL ? CIPHER_IO_ALLOCATION_ERROR : status;
+  }
+
+  if (status == CIPHER_IO_SUCCESS)
+  {
+    status = run_ring (&ring, slots, slot_count, engine, input_fd, output_fd,
+                       length, block_size);
+  }
+
+  // Tearing the ring down first cancels whatever is still in flight, so the
+  // kernel doesn't read or write into freed buffers.
+  ring_free (&ring);
+
+  for (int i = 0; i < slot_count; i++)
+  {
+    free (slots[i].buffer);
+  }
+  free (slots);
+
+  return status;
+}
+
+/**
+ * @brief Keeps every slot busy until the whole input was written back.
+ * Each completion either resubmits the remainder of a short read or write,
+ * encodes a block that was fully read and queues its write, or hands the slot
+ * the next unread block.
+ *
+ * @return CIPHER_IO_SUCCESS if the file was transformed, an error otherwise
+ */
+static CipherIoStatus run_ring (Ring *ring, Slot slots[], int slot_count,
+                                const CipherEngine *engine, int input_fd,
+                                int output_fd, size_t length,
+                                size_t block_size)
+{
+  CipherIoStatus status = CIPHER_IO_SUCCESS;
+  off_t next_offset = 0;
+  int in_flight = 0;
+
+  for (int i = 0; i < slot_count; i++)
+  {
+    start_block (&slots[i], &next_offset, length, block_size);
+    ring_queue (ring, &slots[i], input_fd, output_fd);
+    in_flight++;
+  }
+
+  while (in_flight > 0)
+  {
+    if (ring_enter (ring, 1) != 0)
+    {
+      // The ring itself broke, so the blocks in flight can't be waited for -
+      // they're cancelled once the ring is torn down.
+      return CIPHER_IO_READ_ERROR;
+    }
+
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n (ring->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++)
+    {
+      struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+      Slot *slot = (Slot *) (uintptr_t) cqe->user_data;
+      int result = cqe->res;
+
+      if (result == -EINTR || result == -EAGAIN)
+      {
+        ring_queue (ring, slot, input_fd, output_fd);
+        continue;
+      }
+
+      if (result <= 0)
+      {
+        // A read of 0 bytes means the file shrank while we were reading it
+        if (status == CIPHER_IO_SUCCESS)
+        {
+          status = slot->writing ? CIPHER_IO_WRITE_ERROR
+                                 : CIPHER_IO_READ_ERROR;
+        }
+        in_flight--;
+        continue;
+      }
+
+      slot->done += (size_t) result;
+      if (slot->done < slot->length)
+      {
+        ring_queue (ring, slot, input_fd, output_fd);
+        continue;
+      }
+
+      if (!slot->writing)
+      {
+        cipher_engine_process_at (engine, slot->buffer, slot->buffer,
+                                  slot->length,
+                                  (unsigned long long) slot->offset);
+        slot->writing = 1;
+        slot->done = 0;
+        ring_queue (ring, slot, input_fd, output_fd);
+        continue;
+      }
+
+      // Once anything failed, the remaining blocks are only drained.
+      if (status == CIPHER_IO_SUCCESS && (size_t) next_offset < length)
+      {
+        start_block (slot, &next_offset, length, block_size);
+        ring_queue (ring, slot, input_fd, output_fd);
+        continue;
+      }
+
+      in_flight--;
+    }
+
+    __atomic_store_n (ring->cq_head, head, __ATOMIC_RELEASE);
+  }
+
+  return status;
+}
+
+/**
+ * @brief Hands the given slot the next unread block of the input.
+ */
+static void start_block (Slot *slot, off_t *next_offset, size_t length,
+                         size_t block_size)
+{
+  size_t remaining = length - (size_t) *next_offset;
+
+  slot->offset = *next_offset;
+  slot->length = remaining < block_size ? remaining : block_size;
+  slot->done = 0;
+  slot->writing = 0;
+
+  *next_offset += (off_t) slot->length;
+}
+
+/**
+ * @brief Queues the remainder of the slot's current read or write. It's only
+ * submitted by the next ring_enter.
+ */
+static void ring_queue (Ring *ring, Slot *slot, int input_fd, int output_fd)
+{
+  unsigned index = ring->sq_local_tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[index];
+
+  slot->iov.iov_base = slot->buffer + slot->done;
+  slot->iov.iov_len = slot->length - slot->done;
+
+  memset (sqe, 0, sizeof (*sqe));
+  sqe->opcode = slot->writing ? IORING_OP_WRITEV : IORING_OP_READV;
+  sqe->fd = slot->writing ? output_fd : input_fd;
+  sqe->addr = (unsigned long long) (uintptr_t) &slot->iov;
+  sqe->len = 1;
+  sqe->off = (unsigned long long) slot->offset + slot->done;
+  sqe->user_data = (unsigned long long) (uintptr_t) slot;
+
+  ring->sq_array[index] = index;
+  ring->sq_local_tail++;
+  __atomic_store_n (ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Submits everything queued so far, and waits for completions.
+ *
+ * @param ring initialized ring
+ * @param wait minimal number of completions to wait for
+ * @return 0 upon success, 1 otherwise
+ */
+static int ring_enter (Ring *ring, unsigned wait)
+{
+  while (1)
+  {
+    // The kernel moves the head past whatever it consumed, even when the
+    // call is interrupted while waiting.
+    unsigned pending = ring->sq_local_tail
+                       - __atomic_load_n (ring->sq_head, __ATOMIC_ACQUIRE);
+
+    long result = syscall (__NR_io_uring_enter, ring->fd, pending, wait,
+                           IORING_ENTER_GETEVENTS, NULL, 0);
+    if (result >= 0)
+    {
+      return 0;
+    }
+    if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+    {
+      return 1;
+    }
+  }
+}
+
+/**
+ * @brief Creates an io_uring instance and maps its rings.
+ *
+ * @param ring ring to initialize
+ * @param entries number of submission entries
+ * @return 0 upon success, 1 if io_uring isn't available
+ */
+static int ring_init (Ring *ring, unsigned entries)
+{
+  struct io_uring_params params;
+  memset (&params, 0, sizeof (params));
+  memset (ring, 0, sizeof (*ring));
+
+  ring->fd = (int) syscall (__NR_io_uring_setup, entries, &params);
+  if (ring->fd < 0)
+  {
+    return 1;
+  }
+
+  ring->sq_map_size = params.sq_off.array + params.sq_entries
+                                                * sizeof (unsigned);
+  ring->cq_map_size = params.cq_off.cqes + params.cq_entries
+                                               * sizeof (struct io_uring_cqe);
+
+  // Newer kernels share a single mapping between both rings.
+  int single_map = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_map && ring->cq_map_size > ring->sq_map_size)
+  {
+    ring->sq_map_size = ring->cq_map_size;
+  }
+
+  ring->sq_map = mmap (NULL, ring->sq_map_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, ring->fd, IORING_OFF_SQ_RING);
+  ring->cq_map = single_map ? ring->sq_map
+                            : mmap (NULL, ring->cq_map_size,
+                                    PROT_READ | PROT_WRITE, MAP_SHARED,
+                                    ring->fd, IORING_OFF_CQ_RING);
+  ring->sqes_size = params.sq_entries * sizeof (struct io_uring_sqe);
+  ring->sqes = mmap (NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, ring->fd, IORING_OFF_SQES);
+
+  if (ring->sq_map == MAP_FAILED || ring->cq_map == MAP_FAILED
+      || ring->sqes == MAP_FAILED)
+  {
+    ring_free (ring);
+    return 1;
+  }
+
+  char *sq = ring->sq_map;
+  ring->sq_head = (unsigned *) (sq + params.sq_off.head);
+  ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+  ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+  ring->sq_local_tail = *ring->sq_tail;
+
+  char *cq = ring->cq_map;
+  ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+  ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+  ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+  return 0;
+}
+
+/**
+ * @brief Unmaps the rings of the given ring, and closes it.
+ */
+static void ring_free (Ring *ring)
+{
+  if (ring->sqes != NULL && ring->sqes != MAP_FAILED)
+  {
+    munmap (ring->sqes, ring->sqes_size);
+  }
+  if (ring->cq_map != NULL && ring->cq_map != MAP_FAILED
+      && ring->cq_map != ring->sq_map)
+  {
+    munmap (ring->cq_map, ring->cq_map_size);
+  }
+  if (ring->sq_map != NULL && ring->sq_map != MAP_FAILED)
+  {
+    munmap (ring->sq_map, ring->sq_map_size);
+  }
+
+  close (ring->fd);
+}
+
+#else
+
+CipherIoStatus cipher_uring_transform (const CipherEngine *engine,
+                                       int input_fd, int output_fd,
+                                       size_t length, size_t block_size,
+                                       int queue_depth)
+{
+  (void) engine;
+  (void) input_fd;
+  (void) output_fd;
+  (void) length;
+  (void) block_size;
+  (void) queue_depth;
+
+  return CIPHER_IO_FILE_ERROR;
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef CIPHER_URING_H
+#define CIPHER_URING_H
+
+#include <stddef.h>
+
+#include "cipher_engine.h"
+#include "cipher_io.h"
+
+#define CIPHER_URING_MAX_QUEUE_DEPTH 256
+
+/**
+ * @brief Encodes a regular input file into the output file over io_uring.
+ * Up to ${queue_depth} blocks are in flight at once, each in its own buffer:
+ * a block is read, encoded as soon as its read completes and written back at
+ * the same offset, while the reads and writes of the other blocks are still
+ * running. The output is byte-identical to the other modes.
+ * If io_uring isn't available (an old kernel, a sandbox that forbids it, or
+ * another OS), nothing is written and CIPHER_IO_FILE_ERROR is returned so the
+ * caller can fall back to positional I/O.
+ *
+ * @param engine initialized engine
+ * @param input_fd regular input file, opened for reading
+ * @param output_fd regular output file, opened for writing
+ * @param length size of the input file
+ * @param block_size size of a single block
+ * @param queue_depth number of blocks in flight, up to
+ *                    CIPHER_URING_MAX_QUEUE_DEPTH
+ * @return CIPHER_IO_SUCCESS if the file was transformed, an error otherwise
+ */
+CipherIoStatus cipher_uring_transform (const CipherEngine *engine,
+                                       int input_fd, int output_fd,
+                                       size_t length, size_t block_size,
+                                       int queue_depth);
+
+#endif //CIPHER_URING_H
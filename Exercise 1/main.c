@@ -1,20 +1,67 @@
 #include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "cipher.h"
+#include "cipher_batch.h"
+#include "cipher_bench.h"
+#include "cipher_command.h"
+#include "cipher_crack.h"
+#include "cipher_engine.h"
+#include "cipher_fuzz.h"
+#include "cipher_io.h"
+#include "cipher_parallel.h"
+#include "cipher_uring.h"
 #include "tests.h"
 
 #define BUFFER_LENGTH 1024
 #define ARG_COUNT_TEST 2
 #define ARG_COUNT_CMD 5
+#define ARG_COUNT_CRACK 4
+#define ARG_COUNT_BATCH 3
+#define ARG_COUNT_OPTION 2
 
 #define STRTOL_BASE 10
+#define BYTES_IN_KB 1024
+#define BYTES_IN_MB (1024 * 1024)
+
+#define USAGE_MESSAGE                                                        \
+  "Usage: cipher <encode/decode> <k> <input> <output> [options]\n"           \
+  "       cipher <encode_keyed/decode_keyed> <k1,k2,...> <input> <output>"   \
+  " [options]\n"                                                             \
+  "       cipher crack <input> <output> [--sample <MB>] [options]\n"         \
+  "       cipher batch <manifest> [--threads <N>]\n"                         \
+  "       cipher bench [--size <MB>] [--threads <N>]\n"                      \
+  "       cipher fuzz [--iterations <N>] [--seed <S>]\n"                     \
+  "       cipher test\n"
+
+/**
+ * The options that may follow a command as "--option value" pairs.
+ */
+typedef struct CommandOptions
+{
+  CipherIoOptions io;
+  int line_mode; // Whether to handle the files line by line, as text
+  size_t sample_size; // Number of bytes crack samples, 0 for the whole file
+  size_t bench_size; // Size of each benchmark corpus, in bytes
+  unsigned long iterations; // Number of random cases fuzz checks
+  unsigned int seed; // Seed of fuzz's random cases
+} CommandOptions;
 
 int handle_test_input (char *argv[]);
-int handle_command_input (char *argv[]);
-int run_command (char *command, int k, char *input_path, char *output_path);
+int handle_command_input (int argc, char *argv[]);
+int handle_crack_input (int argc, char *argv[]);
+int handle_bench_input (int argc, char *argv[]);
+int handle_fuzz_input (int argc, char *argv[]);
+int handle_batch_input (int argc, char *argv[]);
+int init_engine (char *command, char *key_arg, CipherEngine *engine);
+int parse_options (int argc, char *argv[], CommandOptions *options);
+int run_command (const CipherEngine *engine, char *input_path,
+                 char *output_path, const CipherIoOptions *options);
+int run_line_command (const CipherEngine *engine, char *input_path,
+                      char *output_path);
 
 int run_tests (void);
 
@@ -23,59 +70,343 @@ int parse_integer (const char *str);
 
 int main (int argc, char *argv[])
 {
-  if (argc != ARG_COUNT_TEST && argc != ARG_COUNT_CMD)
+  // Commands may be followed by any number of "--option value" pairs.
+  if (argc >= ARG_COUNT_CRACK && strcmp (argv[1], "crack") == 0
+      && (argc - ARG_COUNT_CRACK) % ARG_COUNT_OPTION == 0)
+  {
+    return handle_crack_input (argc, argv);
+  }
+
+  if (argc > ARG_COUNT_TEST && strcmp (argv[1], "bench") == 0
+      && (argc - ARG_COUNT_TEST) % ARG_COUNT_OPTION == 0)
+  {
+    return handle_bench_input (argc, argv);
+  }
+
+  if (argc > ARG_COUNT_TEST && strcmp (argv[1], "fuzz") == 0
+      && (argc - ARG_COUNT_TEST) % ARG_COUNT_OPTION == 0)
   {
-    fprintf (stderr, "The program receives 1 or 4 arguments only.\n");
+    return handle_fuzz_input (argc, argv);
+  }
+
+  if (argc >= ARG_COUNT_BATCH && strcmp (argv[1], "batch") == 0
+      && (argc - ARG_COUNT_BATCH) % ARG_COUNT_OPTION == 0)
+  {
+    return handle_batch_input (argc, argv);
+  }
+
+  if (argc != ARG_COUNT_TEST
+      && (argc < ARG_COUNT_CMD
+          || (argc - ARG_COUNT_CMD) % ARG_COUNT_OPTION != 0))
+  {
+    fprintf (stderr, USAGE_MESSAGE);
     return EXIT_FAILURE;
   }
 
   return argc == ARG_COUNT_TEST ? handle_test_input (argv)
-                                : handle_command_input (argv);
+                                : handle_command_input (argc, argv);
 }
 
 /**
  * @brief Handles the program's command mode.
  *
+ * @param argc number of the program's arguments
  * @param argv the program's arguments
  * @return EXIT_SUCCESS if the tests were successful, EXIT_FAILURE otherwise
  */
-int handle_command_input (char *argv[])
+int handle_command_input (int argc, char *argv[])
 {
   char *command = argv[1];
-  if (strcmp (command, "encode") != 0 && strcmp (command, "decode") != 0)
+  if (!cipher_command_is_valid (command))
   {
     fprintf (stderr, "The given command is invalid.\n");
     return EXIT_FAILURE;
   }
 
-  // Setting endptr & errno to detect whether the returned value of strtol is
-  // a valid integer, or whether the action failed.
-  char *endptr = NULL;
-  errno = 0;
+  char *input_path = argv[3];
+  char *output_path = argv[4];
 
-  int k = (int) strtol (argv[2], &endptr, STRTOL_BASE);
-  if (errno != 0 || !argv[2] || *endptr)
+  CommandOptions options;
+  if (parse_options (argc - ARG_COUNT_CMD, argv + ARG_COUNT_CMD, &options)
+      != EXIT_SUCCESS)
   {
-    fprintf (stderr, "The given shift value is invalid.\n");
     return EXIT_FAILURE;
   }
 
-  char *input_path = argv[3];
-  char *output_path = argv[4];
+  CipherEngine engine;
+  if (init_engine (command, argv[2], &engine) != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
 
-  return run_command (command, k, input_path, output_path);
+  int result = run_command (&engine, input_path, output_path,
+                            options.line_mode ? NULL : &options.io);
+
+  cipher_engine_free (&engine);
+  return result;
 }
 
 /**
- * @brief Runs the actual encryption/decryption command.
+ * @brief Handles the program's crack mode - decodes a file that was encoded
+ * with an unknown shift value, and prints the recovered shift value.
+ * Usage: cipher crack <input> <output> [--sample <MB>] [options]
+ *
+ * @param argc number of the program's arguments
+ * @param argv the program's arguments
+ * @return EXIT_SUCCESS if the file was decoded, EXIT_FAILURE otherwise
+ */
+int handle_crack_input (int argc, char *argv[])
+{
+  char *input_path = argv[2];
+  char *output_path = argv[3];
+
+  CommandOptions options;
+  if (parse_options (argc - ARG_COUNT_CRACK, argv + ARG_COUNT_CRACK,
+                     &options)
+      != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+
+  int k = 0;
+  CipherIoStatus status
+      = cipher_crack_file (input_path, options.sample_size, &k);
+  if (status != CIPHER_IO_SUCCESS)
+  {
+    fprintf (stderr, "%s\n", cipher_io_status_message (status));
+    return EXIT_FAILURE;
+  }
+
+  printf ("Recovered shift value: %d\n", k);
+  fflush (stdout);
+
+  CipherEngine engine;
+  cipher_engine_init (&engine, k);
+  cipher_engine_invert (&engine);
+
+  return run_command (&engine, input_path, output_path,
+                      options.line_mode ? NULL : &options.io);
+}
+
+/**
+ * @brief Prepares the engine of the given command.
+ * encode/decode receive a single shift value, while encode_keyed/decode_keyed
+ * receive a comma separated list of shift values (a key schedule).
  *
  * @param command command to run
- * @param k key to use
+ * @param key_arg the command's shift value(s)
+ * @param engine engine to initialize
+ * @return EXIT_SUCCESS if the engine was initialized, EXIT_FAILURE otherwise
+ */
+int init_engine (char *command, char *key_arg, CipherEngine *engine)
+{
+  if (cipher_command_init_engine (command, key_arg, engine) != 0)
+  {
+    fprintf (stderr, cipher_command_is_keyed (command)
+                         ? "The given shift values are invalid.\n"
+                         : "The given shift value is invalid.\n");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Handles the program's benchmark mode.
+ * Usage: cipher bench [--size <MB>] [--threads <N>]
+ *
+ * @param argc number of the program's arguments
+ * @param argv the program's arguments
+ * @return EXIT_SUCCESS if the benchmark passed, EXIT_FAILURE otherwise
+ */
+int handle_bench_input (int argc, char *argv[])
+{
+  CommandOptions options;
+  if (parse_options (argc - ARG_COUNT_TEST, argv + ARG_COUNT_TEST, &options)
+      != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+
+  return run_benchmark (options.bench_size, options.io.threads);
+}
+
+/**
+ * @brief Handles the program's fuzzing mode.
+ * Usage: cipher fuzz [--iterations <N>] [--seed <S>]
+ *
+ * @param argc number of the program's arguments
+ * @param argv the program's arguments
+ * @return EXIT_SUCCESS if all paths matched the reference, EXIT_FAILURE
+ *         otherwise
+ */
+int handle_fuzz_input (int argc, char *argv[])
+{
+  CommandOptions options;
+  if (parse_options (argc - ARG_COUNT_TEST, argv + ARG_COUNT_TEST, &options)
+      != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+
+  return run_fuzz (options.iterations, options.seed);
+}
+
+/**
+ * @brief Handles the program's batch mode - runs all jobs of a manifest.
+ * Usage: cipher batch <manifest> [--threads <N>]
+ *
+ * @param argc number of the program's arguments
+ * @param argv the program's arguments
+ * @return EXIT_SUCCESS if all jobs succeeded, EXIT_FAILURE otherwise
+ */
+int handle_batch_input (int argc, char *argv[])
+{
+  CommandOptions options;
+  if (parse_options (argc - ARG_COUNT_BATCH, argv + ARG_COUNT_BATCH,
+                     &options)
+      != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+
+  return run_batch (argv[2], options.io.threads);
+}
+
+/**
+ * @brief Parses the "--option value" pairs following a command.
+ * Supported options:
+ * --io <mmap/stream/uring/line> - how to read and write the files (default
+ *   mmap)
+ * --threads <N> - number of threads to encode with (default 1)
+ * --block-size <KB> - size of a single streamed block (default 1024)
+ * --queue-depth <N> - number of blocks in flight with uring (default 8)
+ * --sample <MB> - number of megabytes crack samples (default whole file)
+ * --size <MB> - size of each benchmark corpus (default 64)
+ * --iterations <N> - number of random cases fuzz checks (default 2000)
+ * --seed <S> - seed of fuzz's random cases (default 0)
+ *
+ * @param argc number of option arguments
+ * @param argv the option arguments
+ * @param options options to fill, starting from the default values
+ * @return EXIT_SUCCESS if the options are valid, EXIT_FAILURE otherwise
+ */
+int parse_options (int argc, char *argv[], CommandOptions *options)
+{
+  cipher_io_default_options (&options->io);
+  options->line_mode = 0;
+  options->sample_size = 0;
+  options->bench_size = BENCH_DEFAULT_SIZE;
+  options->iterations = FUZZ_DEFAULT_ITERATIONS;
+  options->seed = 0;
+
+  for (int i = 0; i < argc; i += ARG_COUNT_OPTION)
+  {
+    char *name = argv[i];
+    char *value = argv[i + 1];
+
+    if (strcmp (name, "--io") == 0 && strcmp (value, "mmap") == 0)
+    {
+      options->io.mode = CIPHER_IO_MMAP;
+    }
+    else if (strcmp (name, "--io") == 0 && strcmp (value, "stream") == 0)
+    {
+      options->io.mode = CIPHER_IO_STREAM;
+    }
+    else if (strcmp (name, "--io") == 0 && strcmp (value, "uring") == 0)
+    {
+      options->io.mode = CIPHER_IO_URING;
+    }
+    else if (strcmp (name, "--io") == 0 && strcmp (value, "line") == 0)
+    {
+      options->line_mode = 1;
+    }
+    else if (strcmp (name, "--threads") == 0 && is_integer (value)
+             && parse_integer (value) >= 1
+             && parse_integer (value) <= CIPHER_MAX_THREADS)
+    {
+      options->io.threads = parse_integer (value);
+    }
+    else if (strcmp (name, "--block-size") == 0 && is_integer (value)
+             && parse_integer (value) >= 1)
+    {
+      options->io.block_size = (size_t) parse_integer (value) * BYTES_IN_KB;
+    }
+    else if (strcmp (name, "--queue-depth") == 0 && is_integer (value)
+             && parse_integer (value) >= 1
+             && parse_integer (value) <= CIPHER_URING_MAX_QUEUE_DEPTH)
+    {
+      options->io.queue_depth = parse_integer (value);
+    }
+    else if (strcmp (name, "--sample") == 0 && is_integer (value)
+             && parse_integer (value) >= 1)
+    {
+      options->sample_size = (size_t) parse_integer (value) * BYTES_IN_MB;
+    }
+    else if (strcmp (name, "--size") == 0 && is_integer (value)
+             && parse_integer (value) >= 1)
+    {
+      options->bench_size = (size_t) parse_integer (value) * BYTES_IN_MB;
+    }
+    else if (strcmp (name, "--iterations") == 0 && is_integer (value)
+             && parse_integer (value) >= 1)
+    {
+      options->iterations = (unsigned long) parse_integer (value);
+    }
+    else if (strcmp (name, "--seed") == 0 && is_integer (value)
+             && parse_integer (value) >= 0)
+    {
+      options->seed = (unsigned int) parse_integer (value);
+    }
+    else
+    {
+      fprintf (stderr, "The given option %s %s is invalid.\n", name, value);
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Runs the actual encryption/decryption command.
+ *
+ * @param engine engine of the command
  * @param input_path path of the input text
  * @param output_path path for the output text
+ * @param options how to transform the files, or NULL to handle them line by
+ *                line
  * @return EXIT_SUCCESS if the command was successful, EXIT_FAILURE otherwise
  */
-int run_command (char *command, int k, char *input_path, char *output_path)
+int run_command (const CipherEngine *engine, char *input_path,
+                 char *output_path, const CipherIoOptions *options)
+{
+  if (options == NULL)
+  {
+    return run_line_command (engine, input_path, output_path);
+  }
+
+  CipherIoStatus status
+      = cipher_io_transform_file (engine, input_path, output_path, options);
+  if (status != CIPHER_IO_SUCCESS)
+  {
+    fprintf (stderr, "%s\n", cipher_io_status_message (status));
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Transforms the input text line by line, as text.
+ *
+ * @param engine initialized engine
+ * @param input_path path of the input text
+ * @param output_path path for the output text
+ * @return EXIT_SUCCESS if the command was successful, EXIT_FAILURE otherwise
+ */
+int run_line_command (const CipherEngine *engine, char *input_path,
+                      char *output_path)
 {
   FILE *input_file = fopen (input_path, "r");
   if (input_file == NULL)
@@ -93,10 +424,13 @@ int run_command (char *command, int k, char *input_path, char *output_path)
   }
 
   char input[BUFFER_LENGTH];
+  unsigned long long position = 0;
   while (fgets (input, sizeof (input), input_file) != NULL)
   {
     // Encoding/Decoding the line
-    strcmp (command, "encode") == 0 ? encode (input, k) : decode (input, k);
+    size_t length = strlen (input);
+    cipher_engine_process_at (engine, input, input, length, position);
+    position += length;
 
     // Writing the line to the output file
     fputs (input, output_file);
@@ -109,7 +443,7 @@ int run_command (char *command, int k, char *input_path, char *output_path)
 }
 
 /**
- * @brief Handles the program's test mode.
+ * @brief Handles the program's test and benchmark modes.
  *
  * @param argv the program's arguments
  * @return EXIT_SUCCESS if the tests were successful, EXIT_FAILURE otherwise
@@ -121,7 +455,17 @@ int handle_test_input (char *argv[])
     return run_tests ();
   }
 
-  fprintf (stderr, "Usage: cipher test\n");
+  if (strcmp (argv[1], "bench") == 0)
+  {
+    return run_benchmark (BENCH_DEFAULT_SIZE, 1);
+  }
+
+  if (strcmp (argv[1], "fuzz") == 0)
+  {
+    return run_fuzz (FUZZ_DEFAULT_ITERATIONS, 0);
+  }
+
+  fprintf (stderr, USAGE_MESSAGE);
   return EXIT_FAILURE;
 }
 
@@ -183,4 +527,34 @@ int run_tests (void)
   }
 
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Checks whether the given string is a valid integer.
+ *
+ * @param str string to check
+ * @return 1 if the string is an integer, 0 otherwise
+ */
+int is_integer (const char *str)
+{
+  // Setting endptr & errno to detect whether the returned value of strtol is
+  // a valid integer, or whether the action failed.
+  char *endptr = NULL;
+  errno = 0;
+
+  long value = strtol (str, &endptr, STRTOL_BASE);
+  return errno == 0 && endptr != str && *endptr == '\0' && value >= INT_MIN
+         && value <= INT_MAX;
+}
+
+/**
+ * @brief Parses the given string as an integer. The string should be checked
+ * with is_integer first.
+ *
+ * @param str string to parse
+ * @return the parsed integer
+ */
+int parse_integer (const char *str)
+{
+  return (int) strtol (str, NULL, STRTOL_BASE);
+}
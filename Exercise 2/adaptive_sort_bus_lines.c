@@ -0,0 +1,552 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "adaptive_sort_bus_lines.h"
+
+// Enough for any array of up to 2^64 lines, given the run stack's invariants
+#define MAX_RUN_COUNT 85
+
+/**
+ * A sorted run of the array, waiting on the run stack to be merged.
+ */
+typedef struct Run
+{
+  BusLine *start;
+  int length;
+} Run;
+
+typedef struct MergeState
+{
+  size_t offset;
+  BusLine *buffer; // Holds the shorter run of a merge
+  int min_gallop;
+  Run runs[MAX_RUN_COUNT];
+  int run_count;
+} MergeState;
+
+static int get_min_run (int length);
+static int count_run (BusLine *start, BusLine *end, size_t offset);
+static void reverse (BusLine *start, BusLine *end);
+static void binary_insertion_sort (BusLine *start, BusLine *end,
+                                   BusLine *sorted_end, size_t offset);
+static void collapse_runs (MergeState *state);
+static void force_collapse_runs (MergeState *state);
+static void merge_at (MergeState *state, int i);
+static void merge_low (MergeState *state, BusLine *left, int left_length,
+                       BusLine *right, int right_length);
+static void merge_high (MergeState *state, BusLine *left, int left_length,
+                        BusLine *right, int right_length);
+static int gallop (int value, const BusLine *base, int length, int hint,
+                   size_t offset, int right);
+
+int adaptive_sort (BusLine *start, BusLine *end, SortKey key)
+{
+  size_t offset = get_key_offset (key);
+  int length = get_number_of_elements (start, end);
+
+  if (length < ADAPTIVE_MIN_MERGE)
+  {
+    binary_insertion_sort (start, end, start + count_run (start, end, offset),
+                           offset);
+    return 1;
+  }
+
+  MergeState *state = malloc (sizeof (MergeState));
+  BusLine *buffer = malloc (sizeof (BusLine) * (length / 2));
+  if (state == NULL || buffer == NULL)
+  {
+    free (state);
+    free (buffer);
+    return 0;
+  }
+
+  state->offset = offset;
+  state->buffer = buffer;
+  state->min_gallop = ADAPTIVE_MIN_GALLOP;
+  state->run_count = 0;
+
+  int min_run = get_min_run (length);
+  for (BusLine *current = start; current < end;)
+  {
+    int run_length = count_run (current, end, offset);
+
+    if (run_length < min_run)
+    {
+      int remaining = get_number_of_elements (current, end);
+      int forced = remaining < min_run ? remaining : min_run;
+
+      binary_insertion_sort (current, current + forced, current + run_length,
+                             offset);
+      run_length = forced;
+    }
+
+    state->runs[state->run_count++] = (Run) { current, run_length };
+    collapse_runs (state);
+
+    current += run_length;
+  }
+
+  force_collapse_runs (state);
+
+  free (buffer);
+  free (state);
+
+  return 1;
+}
+
+/**
+ * Returns the minimum length of a run - between ADAPTIVE_MIN_MERGE / 2 and
+ * ADAPTIVE_MIN_MERGE, such that the array splits into a power of 2 runs, or
+ * slightly fewer, which keeps the merges balanced.
+ */
+static int get_min_run (int length)
+{
+  int remainder = 0;
+  while (length >= ADAPTIVE_MIN_MERGE)
+  {
+    remainder |= length & 1;
+    length >>= 1;
+  }
+
+  return length + remainder;
+}
+
+/**
+ * Returns the length of the run at the start of the array. A strictly
+ * descending run is reversed into an ascending one - strictly, so reversing
+ * it keeps the sort stable.
+ */
+static int count_run (BusLine *start, BusLine *end, size_t offset)
+{
+  BusLine *current = start + 1;
+  if (current >= end)
+  {
+    return get_number_of_elements (start, end);
+  }
+
+  if (get_key_value (current, offset) < get_key_value (start, offset))
+  {
+    while (current + 1 < end
+           && get_key_value (current + 1, offset)
+                  < get_key_value (current, offset))
+    {
+      current++;
+    }
+    reverse (start, current + 1);
+  }
+  else
+  {
+    while (current + 1 < end
+           && get_key_value (current + 1, offset)
+                  >= get_key_value (current, offset))
+    {
+      current++;
+    }
+  }
+
+  // The comparison that ended the run is counted too, unless the array did
+  COUNT_COMPARISONS ((current - start) + (current + 1 < end));
+  return (int) (current - start) + 1;
+}
+
+static void reverse (BusLine *start, BusLine *end)
+{
+  for (end--; start < end; start++, end--)
+  {
+    swap (start, end);
+  }
+}
+
+/**
+ * Sorts the array, whose prefix up to sorted_end is already sorted, by
+ * inserting every other bus line after the last one not larger than it.
+ */
+static void binary_insertion_sort (BusLine *start, BusLine *end,
+                                   BusLine *sorted_end, size_t offset)
+{
+  unsigned long long comparisons = 0;
+
+  for (BusLine *current = sorted_end; current < end; current++)
+  {
+    BusLine pivot = *current;
+    int value = get_key_value (&pivot, offset);
+
+    BusLine *low = start, *high = current;
+    while (low < high)
+    {
+      BusLine *mid = low + ((high - low) / 2);
+      comparisons++;
+
+      if (value < get_key_value (mid, offset))
+      {
+        high = mid;
+      }
+      else
+      {
+        low = mid + 1;
+      }
+    }
+
+    memmove (low + 1, low, sizeof (BusLine) * (current - low));
+    *low = pivot;
+  }
+
+  COUNT_COMPARISONS (comparisons);
+}
+
+/**
+ * Merges runs on top of the stack until their lengths satisfy, from the top
+ * down: every run is longer than the next two together, and longer than the
+ * next one. The lengths then grow at least as fast as the Fibonacci numbers,
+ * so the stack never holds more than MAX_RUN_COUNT runs.
+ */
+static void collapse_runs (MergeState *state)
+{
+  Run *runs = state->runs;
+
+  while (state->run_count > 1)
+  {
+    int i = state->run_count - 2;
+
+    if ((i > 0 && runs[i - 1].length <= runs[i].length + runs[i + 1].length)
+        || (i > 1
+            && runs[i - 2].length <= runs[i - 1].length + runs[i].length))
+    {
+      if (runs[i - 1].length < runs[i + 1].length)
+      {
+        i--;
+      }
+    }
+    else if (runs[i].length > runs[i + 1].length)
+    {
+      break;
+    }
+
+    merge_at (state, i);
+  }
+}
+
+/**
+ * Merges all runs on the stack into one, once the array has no runs left.
+ */
+static void force_collapse_runs (MergeState *state)
+{
+  Run *runs = state->runs;
+
+  while (state->run_count > 1)
+  {
+    int i = state->run_count - 2;
+    if (i > 0 && runs[i - 1].length < runs[i + 1].length)
+    {
+      i--;
+    }
+
+    merge_at (state, i);
+  }
+}
+
+/**
+ * Merges the i-th and (i+1)-th runs on the stack. Bus lines of the left run
+ * which are already before all of the right run, and bus lines of the right
+ * run which are already after all of the left run, are left in place.
+ */
+static void merge_at (MergeState *state, int i)
+{
+  Run *runs = state->runs;
+  BusLine *left = runs[i].start, *right = runs[i + 1].start;
+  int left_length = runs[i].length, right_length = runs[i + 1].length;
+
+  runs[i].length += right_length;
+  if (i == state->run_count - 3)
+  {
+    runs[i + 1] = runs[i + 2];
+  }
+  state->run_count--;
+
+  int skipped = gallop (get_key_value (right, state->offset), left,
+                        left_length, 0, state->offset, 1);
+  left += skipped;
+  left_length -= skipped;
+  if (left_length == 0)
+  {
+    return;
+  }
+
+  right_length = gallop (get_key_value (left + left_length - 1, state->offset),
+                         right, right_length, right_length - 1, state->offset,
+                         0);
+  if (right_length == 0)
+  {
+    return;
+  }
+
+  if (left_length <= right_length)
+  {
+    merge_low (state, left, left_length, right, right_length);
+  }
+  else
+  {
+    merge_high (state, left, left_length, right, right_length);
+  }
+}
+
+/**
+ * Merges 2 adjacent runs, with the left one not longer than the right one,
+ * from the start. The left run is moved aside into the buffer.
+ */
+static void merge_low (MergeState *state, BusLine *left, int left_length,
+                       BusLine *right, int right_length)
+{
+  size_t offset = state->offset;
+  int min_gallop = state->min_gallop;
+  unsigned long long comparisons = 0;
+
+  memcpy (state->buffer, left, sizeof (BusLine) * left_length);
+
+  BusLine *output = left;
+  BusLine *buffered = state->buffer, *buffered_end = buffered + left_length;
+  BusLine *right_end = right + right_length;
+
+  while (buffered < buffered_end && right < right_end)
+  {
+    int left_wins = 0, right_wins = 0;
+
+    // Taking one bus line at a time, until one run keeps winning
+    while (buffered < buffered_end && right < right_end
+           && left_wins < min_gallop && right_wins < min_gallop)
+    {
+      comparisons++;
+      if (get_key_value (right, offset) < get_key_value (buffered, offset))
+      {
+        *output++ = *right++;
+        right_wins++;
+        left_wins = 0;
+      }
+      else
+      {
+        *output++ = *buffered++;
+        left_wins++;
+        right_wins = 0;
+      }
+    }
+
+    if (buffered == buffered_end || right == right_end)
+    {
+      break;
+    }
+
+    // Galloping - moving whole blocks, for as long as they stay long
+    do
+    {
+      min_gallop -= min_gallop > 1;
+
+      left_wins = gallop (get_key_value (right, offset), buffered,
+                          (int) (buffered_end - buffered), 0, offset, 1);
+      memcpy (output, buffered, sizeof (BusLine) * left_wins);
+      output += left_wins;
+      buffered += left_wins;
+      if (buffered == buffered_end)
+      {
+        break;
+      }
+
+      right_wins = gallop (get_key_value (buffered, offset), right,
+                           (int) (right_end - right), 0, offset, 0);
+      memmove (output, right, sizeof (BusLine) * right_wins);
+      output += right_wins;
+      right += right_wins;
+      if (right == right_end)
+      {
+        break;
+      }
+    }
+    while (left_wins >= ADAPTIVE_MIN_GALLOP
+           || right_wins >= ADAPTIVE_MIN_GALLOP);
+
+    // Leaving gallop mode makes entering it again harder
+    min_gallop++;
+  }
+
+  // What's left of the right run is already in place
+  memcpy (output, buffered, sizeof (BusLine) * (buffered_end - buffered));
+
+  state->min_gallop = min_gallop;
+  COUNT_COMPARISONS (comparisons);
+}
+
+/**
+ * Merges 2 adjacent runs, with the right one shorter than the left one,
+ * from the end. The right run is moved aside into the buffer.
+ */
+static void merge_high (MergeState *state, BusLine *left, int left_length,
+                        BusLine *right, int right_length)
+{
+  size_t offset = state->offset;
+  int min_gallop = state->min_gallop;
+  unsigned long long comparisons = 0;
+
+  BusLine *buffer = state->buffer;
+  memcpy (buffer, right, sizeof (BusLine) * right_length);
+
+  // Remaining bus lines of each run, and the end of the unfilled output
+  int i = left_length, j = right_length, output = left_length + right_length;
+
+  while (i > 0 && j > 0)
+  {
+    int left_wins = 0, right_wins = 0;
+
+    while (i > 0 && j > 0 && left_wins < min_gallop
+           && right_wins < min_gallop)
+    {
+      comparisons++;
+      if (get_key_value (buffer + j - 1, offset)
+          < get_key_value (left + i - 1, offset))
+      {
+        left[--output] = left[--i];
+        left_wins++;
+        right_wins = 0;
+      }
+      else
+      {
+        left[--output] = buffer[--j];
+        right_wins++;
+        left_wins = 0;
+      }
+    }
+
+    if (i == 0 || j == 0)
+    {
+      break;
+    }
+
+    do
+    {
+      min_gallop -= min_gallop > 1;
+
+      left_wins = i
+                  - gallop (get_key_value (buffer + j - 1, offset), left, i,
+                            i - 1, offset, 1);
+      output -= left_wins;
+      i -= left_wins;
+      memmove (left + output, left + i, sizeof (BusLine) * left_wins);
+      if (i == 0)
+      {
+        break;
+      }
+
+      right_wins = j
+                   - gallop (get_key_value (left + i - 1, offset), buffer, j,
+                             j - 1, offset, 0);
+      output -= right_wins;
+      j -= right_wins;
+      memcpy (left + output, buffer + j, sizeof (BusLine) * right_wins);
+      if (j == 0)
+      {
+        break;
+      }
+    }
+    while (left_wins >= ADAPTIVE_MIN_GALLOP
+           || right_wins >= ADAPTIVE_MIN_GALLOP);
+
+    min_gallop++;
+  }
+
+  // What's left of the left run is already in place
+  memcpy (left, buffer, sizeof (BusLine) * j);
+
+  state->min_gallop = min_gallop;
+  COUNT_COMPARISONS (comparisons);
+}
+
+/**
+ * Finds where the given value would be inserted into the sorted array -
+ * before all equal bus lines, or after them if ${right} is set.
+ *
+ * It searches outwards from the hint in steps of 1, 3, 7, 15... and then
+ * binary-searches the last step, so it takes O(log(D)) comparisons where D
+ * is the distance from the hint to the result.
+ *
+ * @return the index to insert at, between 0 and length
+ */
+static int gallop (int value, const BusLine *base, int length, int hint,
+                   size_t offset, int right)
+{
+  // The value goes after a bus line if it's larger, or if it's equal and
+  // goes to the right of equal ones.
+#define GOES_AFTER(line)                                                     \
+  (right ? value >= get_key_value ((line), offset)                           \
+         : value > get_key_value ((line), offset))
+
+  // Searching for the result in (last, step], relative to the hint
+  int last = 0, step = 1;
+  unsigned long long comparisons = 1;
+
+  if (GOES_AFTER (base + hint))
+  {
+    int max_step = length - hint;
+    while (step < max_step && GOES_AFTER (base + hint + step))
+    {
+      comparisons++;
+      last = step;
+      step = (step * 2) + 1;
+      if (step <= 0)
+      {
+        step = max_step;
+      }
+    }
+    comparisons += step < max_step;
+
+    if (step > max_step)
+    {
+      step = max_step;
+    }
+    last += hint;
+    step += hint;
+  }
+  else
+  {
+    int max_step = hint + 1;
+    while (step < max_step && !GOES_AFTER (base + hint - step))
+    {
+      comparisons++;
+      last = step;
+      step = (step * 2) + 1;
+      if (step <= 0)
+      {
+        step = max_step;
+      }
+    }
+    comparisons += step < max_step;
+
+    if (step > max_step)
+    {
+      step = max_step;
+    }
+    int previous_last = last;
+    last = hint - step;
+    step = hint - previous_last;
+  }
+
+  // Now base[last] is before the value (or last is -1), and base[step] isn't
+  // (or step is the length).
+  last++;
+  while (last < step)
+  {
+    int mid = last + ((step - last) / 2);
+    comparisons++;
+
+    if (GOES_AFTER (base + mid))
+    {
+      last = mid + 1;
+    }
+    else
+    {
+      step = mid;
+    }
+  }
+
+#undef GOES_AFTER
+
+  COUNT_COMPARISONS (comparisons);
+  return step;
+}
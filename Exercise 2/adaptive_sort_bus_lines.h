@@ -0,0 +1,34 @@
+#ifndef EX2_REPO_ADAPTIVESORTBUSLINES_H
+#define EX2_REPO_ADAPTIVESORTBUSLINES_H
+
+#include "sort_bus_lines.h"
+
+// Arrays shorter than this are binary-insertion sorted as a single run
+#define ADAPTIVE_MIN_MERGE 32
+
+// Wins in a row after which a merge starts galloping
+#define ADAPTIVE_MIN_GALLOP 7
+
+/**
+ * An adaptive merge sort in the manner of timsort, sorting by the given key.
+ * The sort is stable.
+ *
+ * It splits the array into the runs already in it - non-descending runs as
+ * they are, and strictly descending runs reversed - extending short runs to
+ * a minimum length with binary insertion sort. Runs are merged as they're
+ * found, keeping the lengths on the run stack balanced, and a merge which
+ * keeps taking from the same run switches to galloping (exponential search)
+ * to move whole blocks at once.
+ *
+ * A sorted, reversed or nearly sorted array takes O(N), any other O(N*log(N)),
+ * and the merges use at most N/2 bus lines of extra memory.
+ *
+ * @param start the start of the array to sort
+ * @param end the end of the array to sort
+ * @param key the field to sort by
+ * @return 1 if the array was sorted, 0 if memory allocation failed (the
+ *         array is left unchanged)
+ */
+int adaptive_sort (BusLine *start, BusLine *end, SortKey key);
+
+#endif // EX2_REPO_ADAPTIVESORTBUSLINES_H
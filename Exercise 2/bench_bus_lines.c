@@ -0,0 +1,872 @@
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "adaptive_sort_bus_lines.h"
+#include "bench_bus_lines.h"
+#include "key_sort_bus_lines.h"
+#include "parallel_sort_bus_lines.h"
+#include "route_index_bus_lines.h"
+#include "soa_bus_lines.h"
+#include "test_bus_lines.h"
+
+#define DURATION_RANGE (MAX_DURATION - MIN_DURATION + 1)
+
+#define SAWTOOTH_TEETH 16
+#define FEW_UNIQUE_VALUES 3
+#define APPENDED_FRACTION 100 // One in this many lines is an update
+#define BENCH_SEED 2022
+
+// The index is built from most of the lines, and the rest are inserted in
+// batches of this fraction of the lines
+#define INSERTED_FRACTION 10
+#define INSERT_BATCH_FRACTION 100
+
+// Sorting a copy for every query is slow, so only this many queries do
+#define SORTED_QUERY_COUNT 10
+
+// Bubble-sort is quadratic, so it's only run on arrays up to this long
+#define BUBBLE_SORT_MAX_LENGTH 20000
+
+// Widths of the comparisons columns of the sort and partition tables
+#define SORT_COMPARISONS_WIDTH 14
+#define PARTITION_COMPARISONS_WIDTH 12
+
+#define MILLIS_IN_SECOND 1e3
+#define NANOS_IN_MILLI 1e6
+#define MICROS_IN_MILLI 1e3
+
+typedef void (*sort_function) (BusLine *start, BusLine *end);
+
+typedef BusLine *(*partition_function) (BusLine *start, BusLine *end);
+
+typedef struct BenchPartition
+{
+  const char *name;
+  partition_function partition;
+} BenchPartition;
+
+typedef struct BenchSort
+{
+  const char *name;
+  sort_function sort;
+  SortKey key; // The field the sort sorts by
+  int max_length; // The longest array the sort runs on, 0 for any
+} BenchSort;
+
+static void run_sort (const BenchSort *bench_sort, const BusLine *original,
+                      BusLine *copy, int length, BenchResult *result);
+static void run_sort_isolated (const BenchSort *bench_sort,
+                               const BusLine *original, BusLine *copy,
+                               int length, BenchResult *result);
+static void print_result (BenchPattern pattern, const BenchSort *bench_sort,
+                          int length, const BenchResult *result);
+static void print_counters (const SortCounters *counters, double repeats,
+                            int comparisons_width);
+static long get_peak_kb (void);
+static void sort_by_counting (BusLine *start, BusLine *end);
+static void sort_with_keys (BusLine *start, BusLine *end);
+static void sort_in_parallel (BusLine *start, BusLine *end);
+static void sort_in_parallel_stable (BusLine *start, BusLine *end);
+static void sort_with_index (BusLine *start, BusLine *end);
+static void sort_with_qsort (BusLine *start, BusLine *end);
+static void sort_adaptively (BusLine *start, BusLine *end);
+static int compare_duration (const void *a, const void *b);
+static int is_partitioned (const BusLine *start, const BusLine *middle,
+                           const BusLine *end);
+static int open_branch_miss_counter (void);
+static long long read_branch_miss_counter (int counter);
+static void start_branch_miss_counter (int counter);
+static int count_by_scan (const BusLine *start, const BusLine *end,
+                          int min_distance, int max_distance,
+                          int max_duration);
+static int count_by_sorting (const BusLine *start, const BusLine *end,
+                             int min_distance, int max_distance,
+                             int max_duration);
+static unsigned int next_random (unsigned int *state);
+static double get_time_millis (void);
+
+static const BenchSort bench_sorts[] = {
+  { "bubble", &bubble_sort_loop, SORT_BY_DISTANCE, BUBBLE_SORT_MAX_LENGTH },
+  { "quick", &quick_sort, SORT_BY_DURATION, 0 },
+  { "introsort", &introsort, SORT_BY_DURATION, 0 },
+  { "counting", &sort_by_counting, SORT_BY_DURATION, 0 },
+  { "heap", &heap_sort, SORT_BY_DURATION, 0 },
+  { "keys", &sort_with_keys, SORT_BY_DURATION, 0 },
+  { "parallel", &sort_in_parallel, SORT_BY_DURATION, 0 },
+  { "stable", &sort_in_parallel_stable, SORT_BY_DURATION, 0 },
+  { "index", &sort_with_index, SORT_BY_DURATION, 0 },
+  { "adaptive", &sort_adaptively, SORT_BY_DURATION, 0 },
+  { "qsort", &sort_with_qsort, SORT_BY_DURATION, 0 },
+};
+
+int run_benchmarks (int length, BenchPattern pattern)
+{
+  BusLine *original = malloc (sizeof (BusLine) * length);
+  BusLine *copy = malloc (sizeof (BusLine) * length);
+  if (original == NULL || copy == NULL)
+  {
+    free (original);
+    free (copy);
+    printf ("ERROR: Failed to allocate memory\n");
+    return 0;
+  }
+
+  // Touching the copy once up front, so no sort pays for its page faults.
+  memset (copy, 0, sizeof (BusLine) * length);
+
+  int sort_count = sizeof (bench_sorts) / sizeof (bench_sorts[0]);
+  int all_correct = 1;
+
+  printf ("%d bus lines\n", length);
+  printf ("%-11s %-10s %10s %8s %14s %12s %9s  %s\n", "pattern", "sort", "ms",
+          "ns/line", "comparisons", "swaps", "peak KB", "result");
+
+  BenchPattern first = pattern == PATTERN_COUNT ? 0 : pattern;
+  BenchPattern last = pattern == PATTERN_COUNT ? PATTERN_COUNT - 1 : pattern;
+
+  for (BenchPattern current = first; current <= last; current++)
+  {
+    generate_bus_lines (original, original + length, current, BENCH_SEED);
+
+    for (int i = 0; i < sort_count; i++)
+    {
+      if (bench_sorts[i].max_length > 0 && length > bench_sorts[i].max_length)
+      {
+        printf ("%-11s %-10s skipped, runs on %d lines at most\n",
+                get_pattern_name (current), bench_sorts[i].name,
+                bench_sorts[i].max_length);
+        continue;
+      }
+
+      BenchResult result;
+      run_sort_isolated (&bench_sorts[i], original, copy, length, &result);
+      print_result (current, &bench_sorts[i], length, &result);
+
+      all_correct = all_correct && result.sorted && result.same_lines;
+    }
+  }
+
+  free (original);
+  free (copy);
+
+  return all_correct;
+}
+
+static const BenchPartition bench_partitions[] = {
+  { "lomuto", &partition },
+  { "hoare", &partition_median },
+  { "block", &block_partition },
+};
+
+int run_partition_benchmarks (int length, BenchPattern pattern)
+{
+  // Partitioning needs a pivot and at least one element on each side
+  length = length < 3 ? 3 : length;
+
+  BusLine *original = malloc (sizeof (BusLine) * length);
+  BusLine *copy = malloc (sizeof (BusLine) * length);
+  if (original == NULL || copy == NULL)
+  {
+    free (original);
+    free (copy);
+    printf ("ERROR: Failed to allocate memory\n");
+    return 0;
+  }
+
+  int counter = open_branch_miss_counter ();
+  int partition_count = sizeof (bench_partitions)
+                        / sizeof (bench_partitions[0]);
+  int all_correct = 1;
+
+  printf ("%d bus lines, %d repeats\n", length, PARTITION_BENCH_REPEATS);
+  printf ("%-11s %-9s %8s %12s %12s %14s  %s\n", "pattern", "partition",
+          "ns/line", "comparisons", "swaps", "branch misses", "result");
+
+  BenchPattern first = pattern == PATTERN_COUNT ? 0 : pattern;
+  BenchPattern last = pattern == PATTERN_COUNT ? PATTERN_COUNT - 1 : pattern;
+
+  for (BenchPattern current = first; current <= last; current++)
+  {
+    generate_bus_lines (original, original + length, current, BENCH_SEED);
+
+    for (int i = 0; i < partition_count; i++)
+    {
+      double millis = 0;
+      long long branch_misses = 0;
+      int correct = 1;
+      sort_counters = (SortCounters) { 0, 0 };
+
+      for (int repeat = 0; repeat < PARTITION_BENCH_REPEATS; repeat++)
+      {
+        memcpy (copy, original, sizeof (BusLine) * length);
+
+        start_branch_miss_counter (counter);
+        double start_time = get_time_millis ();
+        BusLine *middle = bench_partitions[i].partition (copy, copy + length);
+        millis += get_time_millis () - start_time;
+        branch_misses += read_branch_miss_counter (counter);
+
+        correct = correct && is_partitioned (copy, middle, copy + length);
+      }
+
+      double repeats = PARTITION_BENCH_REPEATS;
+      printf ("%-11s %-9s %8.2f ", get_pattern_name (current),
+              bench_partitions[i].name,
+              (millis * NANOS_IN_MILLI) / (repeats * length));
+      print_counters (&sort_counters, repeats, PARTITION_COMPARISONS_WIDTH);
+      if (counter < 0)
+      {
+        printf ("%14s  %s\n", "n/a", correct ? "ok" : "NOT PARTITIONED");
+      }
+      else
+      {
+        printf ("%14.0f  %s\n", branch_misses / repeats,
+                correct ? "ok" : "NOT PARTITIONED");
+      }
+
+      all_correct = all_correct && correct;
+    }
+  }
+
+  if (counter >= 0)
+  {
+    close (counter);
+  }
+  free (original);
+  free (copy);
+
+  return all_correct;
+}
+
+int run_query_benchmarks (int length, int queries)
+{
+  BusLine *lines = malloc (sizeof (BusLine) * length);
+  int *queries_data = malloc (sizeof (int) * 3 * queries);
+  int *counts = malloc (sizeof (int) * queries);
+  if (lines == NULL || queries_data == NULL || counts == NULL)
+  {
+    free (lines);
+    free (queries_data);
+    free (counts);
+    printf ("ERROR: Failed to allocate memory\n");
+    return 0;
+  }
+
+  generate_bus_lines (lines, lines + length, PATTERN_RANDOM, BENCH_SEED);
+
+  unsigned int state = BENCH_SEED;
+  for (int i = 0; i < queries; i++)
+  {
+    int *query = queries_data + (3 * i);
+    int a = MIN_DISTANCE + (int) (next_random (&state)
+                                  % (MAX_DISTANCE - MIN_DISTANCE + 1));
+    int b = MIN_DISTANCE + (int) (next_random (&state)
+                                  % (MAX_DISTANCE - MIN_DISTANCE + 1));
+    query[0] = a < b ? a : b;
+    query[1] = a < b ? b : a;
+    query[2] = MIN_DURATION + (int) (next_random (&state) % DURATION_RANGE);
+  }
+
+  int all_correct = 1;
+  printf ("%d bus lines, %d queries\n", length, queries);
+
+  // Building the index from most lines, and inserting the rest in batches
+  int inserted = length / INSERTED_FRACTION;
+  int batch = length / INSERT_BATCH_FRACTION > 0
+                  ? length / INSERT_BATCH_FRACTION
+                  : 1;
+
+  RouteIndex index;
+  double start_time = get_time_millis ();
+  if (!create_route_index (lines, lines + length - inserted, &index))
+  {
+    free (lines);
+    free (queries_data);
+    free (counts);
+    printf ("ERROR: Failed to allocate memory\n");
+    return 0;
+  }
+  double build_millis = get_time_millis () - start_time;
+
+  start_time = get_time_millis ();
+  int batches = 0;
+  for (int first = length - inserted; first < length; first += batch)
+  {
+    int last = first + batch < length ? first + batch : length;
+    all_correct = all_correct
+                  && insert_into_route_index (&index, lines + first,
+                                              lines + last);
+    batches++;
+  }
+  double insert_millis = get_time_millis () - start_time;
+
+  printf ("build %d lines: %.2f ms\n", length - inserted, build_millis);
+  printf ("insert %d batches of %d lines: %.2f ms per batch\n", batches,
+          batch, batches > 0 ? insert_millis / batches : 0.0);
+
+  // Counting through the index
+  start_time = get_time_millis ();
+  for (int i = 0; i < queries; i++)
+  {
+    int *query = queries_data + (3 * i);
+    counts[i] = count_route_index (&index, query[0], query[1], query[2]);
+  }
+  double count_millis = get_time_millis () - start_time;
+
+  // Finding the lines through the index
+  BusLine *found_lines = malloc (sizeof (BusLine) * length);
+  long long found = 0;
+  start_time = get_time_millis ();
+  for (int i = 0; i < queries && found_lines != NULL; i++)
+  {
+    int *query = queries_data + (3 * i);
+    int count = query_route_index (&index, query[0], query[1], query[2],
+                                   found_lines, length);
+    all_correct = all_correct && count == counts[i];
+    found += count;
+  }
+  double index_millis = get_time_millis () - start_time;
+  free (found_lines);
+
+  // Scanning the whole array for every query
+  start_time = get_time_millis ();
+  for (int i = 0; i < queries; i++)
+  {
+    int *query = queries_data + (3 * i);
+    int count = count_by_scan (lines, lines + length, query[0], query[1],
+                               query[2]);
+    all_correct = all_correct && count == counts[i];
+  }
+  double scan_millis = get_time_millis () - start_time;
+
+  // Sorting a copy by distance for every query, on a few of them
+  int sorted_queries = queries < SORTED_QUERY_COUNT ? queries
+                                                    : SORTED_QUERY_COUNT;
+  if (length > BUBBLE_SORT_MAX_LENGTH)
+  {
+    sorted_queries = 0;
+  }
+  start_time = get_time_millis ();
+  for (int i = 0; i < sorted_queries; i++)
+  {
+    int *query = queries_data + (3 * i);
+    int count = count_by_sorting (lines, lines + length, query[0], query[1],
+                                  query[2]);
+    all_correct = all_correct && count == counts[i];
+  }
+  double sort_millis = get_time_millis () - start_time;
+
+  printf ("%-8s %14s  %s\n", "query", "us per query", "result");
+  printf ("%-8s %14.2f\n", "count",
+          (count_millis * MICROS_IN_MILLI) / (queries > 0 ? queries : 1));
+  printf ("%-8s %14.2f  %lld lines found\n", "index",
+          (index_millis * MICROS_IN_MILLI) / (queries > 0 ? queries : 1),
+          found);
+  printf ("%-8s %14.2f\n", "scan",
+          (scan_millis * MICROS_IN_MILLI) / (queries > 0 ? queries : 1));
+  if (sorted_queries > 0)
+  {
+    printf ("%-8s %14.2f\n", "sort",
+            (sort_millis * MICROS_IN_MILLI) / sorted_queries);
+  }
+  else
+  {
+    printf ("%-8s %14s  runs on %d lines at most\n", "sort", "skipped",
+            BUBBLE_SORT_MAX_LENGTH);
+  }
+  printf ("%s\n", all_correct ? "ok" : "RESULTS DIFFER");
+
+  free_route_index (&index);
+  free (lines);
+  free (queries_data);
+  free (counts);
+
+  return all_correct;
+}
+
+void generate_bus_lines (BusLine *start, BusLine *end, BenchPattern pattern,
+                         unsigned int seed)
+{
+  int length = get_number_of_elements (start, end);
+  unsigned int state = seed == 0 ? 1 : seed;
+
+  for (int i = 0; i < length; i++)
+  {
+    BusLine *bus_line = start + i;
+    bus_line->line_number
+        = MIN_LINE_NUMBER + (int) (next_random (&state) % MAX_LINE_NUMBER);
+    bus_line->distance = MIN_DISTANCE
+                         + (int) (next_random (&state)
+                                  % (MAX_DISTANCE - MIN_DISTANCE + 1));
+
+    // Scaling in long long, since i * DURATION_RANGE overflows an int for
+    // large arrays.
+    long long scaled = ((long long) i * DURATION_RANGE) / length;
+    long long tooth = length / SAWTOOTH_TEETH + 1;
+    long long pipe = ((long long) (i < length / 2 ? i : length - 1 - i)
+                      * 2 * DURATION_RANGE)
+                     / (length + 1);
+
+    switch (pattern)
+    {
+    case PATTERN_SORTED:
+      bus_line->duration = MIN_DURATION + (int) scaled;
+      break;
+    case PATTERN_REVERSED:
+      bus_line->duration = MAX_DURATION - (int) scaled;
+      break;
+    case PATTERN_SAWTOOTH:
+      bus_line->duration
+          = MIN_DURATION + (int) (((i % tooth) * DURATION_RANGE) / tooth);
+      break;
+    case PATTERN_FEW_UNIQUE:
+      bus_line->duration
+          = MIN_DURATION + (int) (next_random (&state) % FEW_UNIQUE_VALUES);
+      break;
+    case PATTERN_ORGAN_PIPE:
+      bus_line->duration = MIN_DURATION + (int) pipe;
+      break;
+    case PATTERN_APPENDED:
+      bus_line->duration
+          = i < length - (length / APPENDED_FRACTION)
+                ? MIN_DURATION + (int) scaled
+                : MIN_DURATION + (int) (next_random (&state) % DURATION_RANGE);
+      break;
+    default:
+      bus_line->duration
+          = MIN_DURATION + (int) (next_random (&state) % DURATION_RANGE);
+      break;
+    }
+  }
+}
+
+const char *get_pattern_name (BenchPattern pattern)
+{
+  switch (pattern)
+  {
+  case PATTERN_SORTED:
+    return "sorted";
+  case PATTERN_REVERSED:
+    return "reversed";
+  case PATTERN_SAWTOOTH:
+    return "sawtooth";
+  case PATTERN_FEW_UNIQUE:
+    return "few-unique";
+  case PATTERN_ORGAN_PIPE:
+    return "organ-pipe";
+  case PATTERN_APPENDED:
+    return "appended";
+  default:
+    return "random";
+  }
+}
+
+int parse_pattern (const char *name, BenchPattern *pattern)
+{
+  if (strcmp (name, "all") == 0)
+  {
+    *pattern = PATTERN_COUNT;
+    return 1;
+  }
+
+  for (BenchPattern current = 0; current < PATTERN_COUNT; current++)
+  {
+    if (strcmp (name, get_pattern_name (current)) == 0)
+    {
+      *pattern = current;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Runs a single sort on a fresh copy of the original array, and checks its
+ * result.
+ */
+static void run_sort (const BenchSort *bench_sort, const BusLine *original,
+                      BusLine *copy, int length, BenchResult *result)
+{
+  memcpy (copy, original, sizeof (BusLine) * length);
+
+  sort_counters = (SortCounters) { 0, 0 };
+  long peak_before = get_peak_kb ();
+
+  double start_time = get_time_millis ();
+  bench_sort->sort (copy, copy + length);
+  result->millis = get_time_millis () - start_time;
+
+  result->counters = sort_counters;
+  result->peak_kb = get_peak_kb () - peak_before;
+
+  result->sorted = bench_sort->key == SORT_BY_DISTANCE
+                       ? is_sorted_by_distance (copy, copy + length)
+                       : is_sorted_by_duration (copy, copy + length);
+  result->same_lines = is_equal (copy, copy + length, (BusLine *) original,
+                                 (BusLine *) original + length);
+}
+
+/**
+ * Runs a single sort in a child process, whose peak memory starts from the
+ * memory it shares with this one. Runs it in this process if it can't fork.
+ */
+static void run_sort_isolated (const BenchSort *bench_sort,
+                               const BusLine *original, BusLine *copy,
+                               int length, BenchResult *result)
+{
+  int fds[2];
+  pid_t child = -1;
+
+  if (pipe (fds) == 0)
+  {
+    fflush (stdout);
+    child = fork ();
+    if (child < 0)
+    {
+      close (fds[0]);
+      close (fds[1]);
+    }
+  }
+
+  if (child < 0)
+  {
+    run_sort (bench_sort, original, copy, length, result);
+    result->peak_kb = -1;
+    return;
+  }
+
+  if (child == 0)
+  {
+    close (fds[0]);
+    run_sort (bench_sort, original, copy, length, result);
+    ssize_t written = write (fds[1], result, sizeof (*result));
+    _exit (written == (ssize_t) sizeof (*result) ? EXIT_SUCCESS
+                                                 : EXIT_FAILURE);
+  }
+
+  close (fds[1]);
+  ssize_t length_read = read (fds[0], result, sizeof (*result));
+  close (fds[0]);
+  waitpid (child, NULL, 0);
+
+  // The child crashed before reporting
+  if (length_read != (ssize_t) sizeof (*result))
+  {
+    *result = (BenchResult) { 0, { 0, 0 }, -1, 0, 0 };
+  }
+}
+
+static void print_result (BenchPattern pattern, const BenchSort *bench_sort,
+                          int length, const BenchResult *result)
+{
+  const char *status = !result->sorted       ? "NOT SORTED"
+                       : !result->same_lines ? "LINES CHANGED"
+                                             : "ok";
+
+  printf ("%-11s %-10s %10.2f %8.1f ", get_pattern_name (pattern),
+          bench_sort->name, result->millis,
+          (result->millis * NANOS_IN_MILLI) / (length > 0 ? length : 1));
+  print_counters (&result->counters, 1, SORT_COMPARISONS_WIDTH);
+
+  if (result->peak_kb < 0)
+  {
+    printf ("%9s  %s\n", "n/a", status);
+  }
+  else
+  {
+    printf ("%9ld  %s\n", result->peak_kb, status);
+  }
+}
+
+/**
+ * Returns the peak resident memory of this process, in KB.
+ */
+static long get_peak_kb (void)
+{
+  struct rusage usage;
+  if (getrusage (RUSAGE_SELF, &usage) != 0)
+  {
+    return 0;
+  }
+
+  return usage.ru_maxrss;
+}
+
+/**
+ * Sorts the array by duration with counting-sort alone, falling back to
+ * introsort only if it can't allocate its buffers.
+ */
+static void sort_by_counting (BusLine *start, BusLine *end)
+{
+  if (!counting_sort (start, end, SORT_BY_DURATION))
+  {
+    introsort (start, end);
+  }
+}
+
+/**
+ * Sorts the array by duration through packed keys, stably.
+ */
+static void sort_with_keys (BusLine *start, BusLine *end)
+{
+  SortSpec spec = { { SORT_BY_DURATION }, { 0 }, 1 };
+  key_sort (start, end, &spec);
+}
+
+/**
+ * Sorts the array by duration with a thread per processor.
+ */
+static void sort_in_parallel (BusLine *start, BusLine *end)
+{
+  parallel_sort (start, end, get_processor_count ());
+}
+
+/**
+ * Sorts the array by duration stably, with a thread per processor.
+ */
+static void sort_in_parallel_stable (BusLine *start, BusLine *end)
+{
+  parallel_stable_sort (start, end, get_processor_count ());
+}
+
+/**
+ * Sorts the array by duration through columns - splits it into columns,
+ * sorts an index by the durations column, and gathers the lines back.
+ */
+static void sort_with_index (BusLine *start, BusLine *end)
+{
+  BusLineColumns columns;
+  if (!create_columns (start, end, &columns))
+  {
+    return;
+  }
+
+  int *index = malloc (sizeof (int) * (columns.length + 1));
+  if (index != NULL && sort_index (&columns, SORT_BY_DURATION, index))
+  {
+    gather_bus_lines (&columns, index, start);
+  }
+
+  free (index);
+  free_columns (&columns);
+}
+
+/**
+ * Sorts the array by duration with the adaptive merge sort.
+ */
+static void sort_adaptively (BusLine *start, BusLine *end)
+{
+  adaptive_sort (start, end, SORT_BY_DURATION);
+}
+
+/**
+ * Sorts the array by duration with the C library's qsort, as a baseline.
+ */
+static void sort_with_qsort (BusLine *start, BusLine *end)
+{
+  qsort (start, get_number_of_elements (start, end), sizeof (BusLine),
+         &compare_duration);
+}
+
+static int compare_duration (const void *a, const void *b)
+{
+  int first = ((const BusLine *) a)->duration;
+  int second = ((const BusLine *) b)->duration;
+
+  COUNT_COMPARISONS (1);
+  return (first > second) - (first < second);
+}
+
+/**
+ * Checks that no duration before the middle is larger than the middle's, and
+ * none after it is smaller.
+ */
+static int is_partitioned (const BusLine *start, const BusLine *middle,
+                           const BusLine *end)
+{
+  for (const BusLine *line = start; line < middle; line++)
+  {
+    if (line->duration > middle->duration)
+    {
+      return 0;
+    }
+  }
+  for (const BusLine *line = middle + 1; line < end; line++)
+  {
+    if (line->duration < middle->duration)
+    {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/**
+ * Opens a counter of this thread's branch mispredictions in user space.
+ *
+ * @return the counter, or -1 if the system doesn't provide one (a virtual
+ *         machine without a PMU, or a restrictive perf_event_paranoid)
+ */
+static int open_branch_miss_counter (void)
+{
+#ifdef __linux__
+  struct perf_event_attr attributes;
+  memset (&attributes, 0, sizeof (attributes));
+  attributes.type = PERF_TYPE_HARDWARE;
+  attributes.size = sizeof (attributes);
+  attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+  attributes.disabled = 1;
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+
+  return (int) syscall (SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+#else
+  return -1;
+#endif
+}
+
+static void start_branch_miss_counter (int counter)
+{
+#ifdef __linux__
+  if (counter >= 0)
+  {
+    ioctl (counter, PERF_EVENT_IOC_RESET, 0);
+    ioctl (counter, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#else
+  (void) counter;
+#endif
+}
+
+/**
+ * Stops the counter, and returns the branch misses since it was started.
+ */
+static long long read_branch_miss_counter (int counter)
+{
+  long long count = 0;
+
+#ifdef __linux__
+  if (counter >= 0)
+  {
+    ioctl (counter, PERF_EVENT_IOC_DISABLE, 0);
+    if (read (counter, &count, sizeof (count)) != (ssize_t) sizeof (count))
+    {
+      count = 0;
+    }
+  }
+#else
+  (void) counter;
+#endif
+
+  return count;
+}
+
+/**
+ * Counts the lines of a query by checking every line of the array.
+ */
+static int count_by_scan (const BusLine *start, const BusLine *end,
+                          int min_distance, int max_distance,
+                          int max_duration)
+{
+  int count = 0;
+  for (const BusLine *line = start; line < end; line++)
+  {
+    count += line->distance >= min_distance && line->distance <= max_distance
+             && line->duration <= max_duration;
+  }
+
+  return count;
+}
+
+/**
+ * Counts the lines of a query the way it was done before the route index -
+ * bubble-sorting a copy of the array by distance, and scanning the distance
+ * range. Bypasses bubble_sort's counting-sort, as the old code had none.
+ */
+static int count_by_sorting (const BusLine *start, const BusLine *end,
+                             int min_distance, int max_distance,
+                             int max_duration)
+{
+  int length = get_number_of_elements ((BusLine *) start, (BusLine *) end);
+  BusLine *copy = malloc (sizeof (BusLine) * length);
+  if (copy == NULL)
+  {
+    return -1;
+  }
+
+  memcpy (copy, start, sizeof (BusLine) * length);
+  bubble_sort_loop (copy, copy + length);
+
+  int count = 0;
+  for (BusLine *line = copy; line < copy + length; line++)
+  {
+    if (line->distance > max_distance)
+    {
+      break;
+    }
+    count += line->distance >= min_distance && line->duration <= max_duration;
+  }
+
+  free (copy);
+  return count;
+}
+
+/**
+ * A xorshift generator - fast, and the same on every platform unlike rand().
+ */
+static unsigned int next_random (unsigned int *state)
+{
+  unsigned int x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+
+  return x;
+}
+
+/**
+ * Returns a monotonic timestamp in milliseconds.
+ */
+static double get_time_millis (void)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+
+  return ((double) now.tv_sec * MILLIS_IN_SECOND)
+         + ((double) now.tv_nsec / NANOS_IN_MILLI);
+}
+
+/**
+ * Prints the comparisons and swaps of a run, averaged over its repeats - or
+ * n/a, when the sorts were built without SORT_COUNTERS.
+ */
+static void print_counters (const SortCounters *counters, double repeats,
+                            int comparisons_width)
+{
+#ifdef SORT_COUNTERS
+  printf ("%*.0f %12.0f ", comparisons_width,
+          counters->comparisons / repeats, counters->swaps / repeats);
+#else
+  (void) counters;
+  (void) repeats;
+  printf ("%*s %12s ", comparisons_width, "n/a", "n/a");
+#endif
+}
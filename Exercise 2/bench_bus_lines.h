@@ -0,0 +1,112 @@
+#ifndef EX2_REPO_BENCHBUSLINES_H
+#define EX2_REPO_BENCHBUSLINES_H
+
+#include "sort_bus_lines.h"
+
+#define BENCH_LENGTH 1000000
+
+/**
+ * The shapes of generated arrays, by their durations.
+ */
+typedef enum BenchPattern
+{
+  PATTERN_RANDOM,
+  PATTERN_SORTED,
+  PATTERN_REVERSED,
+  PATTERN_SAWTOOTH,
+  PATTERN_FEW_UNIQUE,
+  PATTERN_ORGAN_PIPE,
+  PATTERN_APPENDED, // Sorted, with a few random updates appended
+  PATTERN_COUNT
+} BenchPattern;
+
+/**
+ * The result of running a single sort on a single array.
+ */
+typedef struct BenchResult
+{
+  double millis;
+  SortCounters counters;
+  long peak_kb; // Memory the sort allocated at its peak, -1 if unknown
+  int sorted, same_lines;
+} BenchResult;
+
+/**
+ * Runs the benchmark mode - runs every sort on generated arrays of ${length}
+ * bus lines, and reports its time, comparisons, swaps and peak memory, and
+ * whether its result is sorted and holds the same bus lines. Comparisons and
+ * swaps are only counted when built with -DSORT_COUNTERS.
+ *
+ * Every sort runs in a child process of its own, so its peak memory is
+ * measured apart from the other sorts, and a crashing sort is reported
+ * rather than ending the benchmark. The bubble row runs bubble-sort's
+ * comparisons without its counting-sort, so it's skipped on long arrays.
+ *
+ * @param length number of bus lines in each array
+ * @param pattern the pattern of the arrays, or PATTERN_COUNT for all of them
+ * @return 1 if all results were correct, 0 otherwise
+ */
+int run_benchmarks (int length, BenchPattern pattern);
+
+#define QUERY_BENCH_LENGTH 1000000
+#define QUERY_BENCH_COUNT 1000
+
+/**
+ * Runs the query benchmark mode - builds a route index over ${length}
+ * generated bus lines, partly through batched inserts, and times ${queries}
+ * random "distance in [a, b] and duration of at most d" queries on it -
+ * counting the lines and finding them - against scanning the whole array
+ * and against bubble-sorting a copy of it by distance for every query, which
+ * is skipped on long arrays.
+ *
+ * @param length number of bus lines to index
+ * @param queries number of queries to run
+ * @return 1 if all ways found the same lines, 0 otherwise
+ */
+int run_query_benchmarks (int length, int queries);
+
+#define PARTITION_BENCH_REPEATS 10
+
+/**
+ * Runs the partition benchmark mode - partitions arrays of ${length}
+ * generated bus lines with the original Lomuto partition, the Hoare
+ * partition and the block partition, and reports their time, comparisons,
+ * swaps and branch misses. Comparisons and swaps are only counted when built
+ * with -DSORT_COUNTERS, and branch misses are read from the CPU's counters,
+ * where the system allows it.
+ *
+ * @param length number of bus lines in each array
+ * @param pattern the pattern of the arrays, or PATTERN_COUNT for all of them
+ * @return 1 if all partitions were correct, 0 otherwise
+ */
+int run_partition_benchmarks (int length, BenchPattern pattern);
+
+/**
+ * Fills the given array with valid bus lines, whose durations follow the
+ * given pattern.
+ *
+ * @param start the start of the array to fill
+ * @param end the end of the array to fill
+ * @param pattern the shape of the durations
+ * @param seed seed of the random values
+ */
+void generate_bus_lines (BusLine *start, BusLine *end, BenchPattern pattern,
+                         unsigned int seed);
+
+/**
+ * Returns the name of the given pattern.
+ *
+ * @param pattern the pattern to name
+ */
+const char *get_pattern_name (BenchPattern pattern);
+
+/**
+ * Finds the pattern of the given name.
+ *
+ * @param name the name of the pattern, or "all"
+ * @param pattern set to the pattern, or PATTERN_COUNT for "all"
+ * @return 1 if the name is valid, 0 otherwise
+ */
+int parse_pattern (const char *name, BenchPattern *pattern);
+
+#endif // EX2_REPO_BENCHBUSLINES_H
@@ -0,0 +1,490 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "external_sort_bus_lines.h"
+
+/**
+ * A sorted run being merged, read through a buffer of its own.
+ */
+typedef struct RunReader
+{
+  FILE *file;
+  BusLine *buffer;
+  size_t capacity, count, position;
+} RunReader;
+
+/**
+ * A list of sorted runs, each in a temporary file of its own.
+ */
+typedef struct RunList
+{
+  FILE **files;
+  long count, capacity;
+} RunList;
+
+static LoadStatus split_runs (FILE *input, FILE *output, const SortSpec *spec,
+                              size_t memory_budget, LoadReport *report,
+                              ExternalSortStats *stats, RunList *runs);
+static LoadStatus merge_all_runs (RunList *runs, FILE *output,
+                                  const SortSpec *spec, size_t memory_budget,
+                                  ExternalSortStats *stats);
+static LoadStatus merge_runs (FILE **files, int count, FILE *output,
+                              const SortSpec *spec, BusLine *memory,
+                              size_t memory_lines);
+static int build_loser_tree (int *tree, int node, int count,
+                             const RunReader *readers, const SortSpec *spec);
+static int is_before (const RunReader *readers, int first, int second,
+                      const SortSpec *spec);
+static const BusLine *get_current (const RunReader *reader);
+static int advance_reader (RunReader *reader);
+static LoadStatus write_lines (FILE *file, const BusLine *start, size_t count);
+static int add_run (RunList *runs, FILE *file);
+static void close_runs (FILE **files, long count);
+static int get_fan_in (size_t memory_budget);
+static int is_same_file (FILE *input, const char *output_path);
+
+LoadStatus external_sort (const char *input_path, const char *output_path,
+                          const SortSpec *spec, size_t memory_budget,
+                          LoadReport *report, ExternalSortStats *stats)
+{
+  *report = (LoadReport) { 0 };
+  *stats = (ExternalSortStats) { 0 };
+
+  if (memory_budget < EXTERNAL_MIN_MEMORY)
+  {
+    memory_budget = EXTERNAL_MIN_MEMORY;
+  }
+
+  FILE *input = fopen (input_path, "rb");
+  if (input == NULL)
+  {
+    return LOAD_FILE_ERROR;
+  }
+
+  // Opening the output truncates it, before a single line was read
+  if (is_same_file (input, output_path))
+  {
+    fclose (input);
+    return LOAD_FILE_ERROR;
+  }
+
+  FILE *output = fopen (output_path, "wb");
+  if (output == NULL)
+  {
+    fclose (input);
+    return LOAD_FILE_ERROR;
+  }
+
+  // All reads and writes go through the sort's own large buffers
+  setvbuf (input, NULL, _IONBF, 0);
+  setvbuf (output, NULL, _IONBF, 0);
+
+  RunList runs = { NULL, 0, 0 };
+  LoadStatus status = split_runs (input, output, spec, memory_budget, report,
+                                  stats, &runs);
+  fclose (input);
+
+  if (status == LOAD_SUCCESS && runs.count > 0)
+  {
+    status = merge_all_runs (&runs, output, spec, memory_budget, stats);
+  }
+
+  close_runs (runs.files, runs.count);
+  free (runs.files);
+
+  if (fclose (output) != 0 && status == LOAD_SUCCESS)
+  {
+    status = LOAD_FILE_ERROR;
+  }
+
+  return status;
+}
+
+/**
+ * Reads the input in runs as large as the budget allows, and writes every
+ * run sorted into a temporary file - or straight into the output, if the
+ * whole input is a single run.
+ */
+static LoadStatus split_runs (FILE *input, FILE *output, const SortSpec *spec,
+                              size_t memory_budget, LoadReport *report,
+                              ExternalSortStats *stats, RunList *runs)
+{
+  size_t run_capacity = memory_budget / EXTERNAL_BYTES_PER_LINE;
+  BusLine *run = malloc (sizeof (BusLine) * run_capacity);
+  if (run == NULL)
+  {
+    return LOAD_ALLOCATION_ERROR;
+  }
+
+  LoadStatus status = LOAD_SUCCESS;
+
+  while (status == LOAD_SUCCESS)
+  {
+    // Reading bytes rather than lines, so a partial line at the end shows
+    size_t bytes = fread (run, 1, sizeof (BusLine) * run_capacity, input);
+    if (ferror (input))
+    {
+      status = LOAD_FILE_ERROR;
+      break;
+    }
+    if (bytes % sizeof (BusLine) != 0)
+    {
+      status = LOAD_FORMAT_ERROR;
+      break;
+    }
+    if (bytes == 0)
+    {
+      break;
+    }
+
+    size_t count = bytes / sizeof (BusLine);
+    int is_last = count < run_capacity;
+
+    // Validating the run on its own, then numbering its bad rows by their
+    // place in the whole file.
+    LoadReport run_report = { 0 };
+    BusLine *valid_end = validate_bus_lines (run, run + count, &run_report);
+    for (int i = 0; i < run_report.reported; i++)
+    {
+      if (report->reported < MAX_REPORTED_ROWS)
+      {
+        BadRow bad = run_report.bad[i];
+        bad.row += report->rows;
+        report->bad[report->reported++] = bad;
+      }
+    }
+    report->bad_rows += run_report.bad_rows;
+    report->rows += (long) count;
+
+    if (!key_sort (run, valid_end, spec))
+    {
+      status = LOAD_ALLOCATION_ERROR;
+      break;
+    }
+
+    size_t valid_count = (size_t) (valid_end - run);
+    stats->lines += (long long) valid_count;
+    stats->runs++;
+
+    if (is_last && runs->count == 0)
+    {
+      status = write_lines (output, run, valid_count);
+      break;
+    }
+
+    FILE *file = tmpfile ();
+    if (file == NULL)
+    {
+      status = LOAD_FILE_ERROR;
+      break;
+    }
+    setvbuf (file, NULL, _IONBF, 0);
+
+    if (!add_run (runs, file))
+    {
+      fclose (file);
+      status = LOAD_ALLOCATION_ERROR;
+      break;
+    }
+    status = write_lines (file, run, valid_count);
+
+    if (is_last)
+    {
+      break;
+    }
+  }
+
+  free (run);
+  return status;
+}
+
+/**
+ * Merges all runs into the output - in groups of as many runs as the budget
+ * can give large buffers to, until a single group is left.
+ */
+static LoadStatus merge_all_runs (RunList *runs, FILE *output,
+                                  const SortSpec *spec, size_t memory_budget,
+                                  ExternalSortStats *stats)
+{
+  size_t memory_lines = memory_budget / sizeof (BusLine);
+  BusLine *memory = malloc (sizeof (BusLine) * memory_lines);
+  if (memory == NULL)
+  {
+    return LOAD_ALLOCATION_ERROR;
+  }
+
+  int fan_in = get_fan_in (memory_budget);
+  LoadStatus status = LOAD_SUCCESS;
+
+  while (status == LOAD_SUCCESS && runs->count > fan_in)
+  {
+    RunList merged = { NULL, 0, 0 };
+
+    for (long first = 0; first < runs->count && status == LOAD_SUCCESS;
+         first += fan_in)
+    {
+      long count = runs->count - first < fan_in ? runs->count - first : fan_in;
+      FILE *file = tmpfile ();
+
+      if (file == NULL || !add_run (&merged, file))
+      {
+        if (file != NULL)
+        {
+          fclose (file);
+        }
+        status = file == NULL ? LOAD_FILE_ERROR : LOAD_ALLOCATION_ERROR;
+        break;
+      }
+      setvbuf (file, NULL, _IONBF, 0);
+
+      status = merge_runs (runs->files + first, (int) count, file, spec,
+                           memory, memory_lines);
+    }
+
+    // The merged runs replace the ones they were merged from
+    close_runs (runs->files, runs->count);
+    free (runs->files);
+    *runs = merged;
+    stats->merge_passes++;
+  }
+
+  if (status == LOAD_SUCCESS)
+  {
+    status = merge_runs (runs->files, (int) runs->count, output, spec, memory,
+                         memory_lines);
+    stats->merge_passes++;
+  }
+
+  free (memory);
+  return status;
+}
+
+/**
+ * Merges the given runs into the output through a loser tree. The memory is
+ * split into a buffer for every run and one for the output.
+ *
+ * The tree's internal nodes hold the run which lost the match at that node,
+ * and its root holds the winner of the whole tournament. Once the winner's
+ * bus line is written, its run's next bus line only replays the matches on
+ * the path from its leaf to the root.
+ */
+static LoadStatus merge_runs (FILE **files, int count, FILE *output,
+                              const SortSpec *spec, BusLine *memory,
+                              size_t memory_lines)
+{
+  RunReader *readers = calloc (count, sizeof (RunReader));
+  int *tree = malloc (sizeof (int) * count);
+  if (readers == NULL || tree == NULL)
+  {
+    free (readers);
+    free (tree);
+    return LOAD_ALLOCATION_ERROR;
+  }
+
+  size_t buffer_lines = memory_lines / (size_t) (count + 1);
+  BusLine *output_buffer = memory + (buffer_lines * count);
+  size_t output_count = 0;
+  LoadStatus status = LOAD_SUCCESS;
+
+  for (int i = 0; i < count; i++)
+  {
+    rewind (files[i]);
+    readers[i] = (RunReader) { files[i], memory + (buffer_lines * i),
+                               buffer_lines, 0, 0 };
+    if (!advance_reader (&readers[i]))
+    {
+      status = LOAD_FILE_ERROR;
+    }
+  }
+
+  // Leaves are numbered from count to 2 * count - 1, after the internal nodes
+  tree[0] = build_loser_tree (tree, 1, count, readers, spec);
+
+  while (status == LOAD_SUCCESS && get_current (&readers[tree[0]]) != NULL)
+  {
+    int winner = tree[0];
+
+    output_buffer[output_count++] = *get_current (&readers[winner]);
+    if (output_count == buffer_lines)
+    {
+      status = write_lines (output, output_buffer, output_count);
+      output_count = 0;
+    }
+
+    readers[winner].position++;
+    if (!advance_reader (&readers[winner]))
+    {
+      status = LOAD_FILE_ERROR;
+    }
+
+    for (int node = (winner + count) / 2; node > 0; node /= 2)
+    {
+      if (is_before (readers, tree[node], winner, spec))
+      {
+        int loser = winner;
+        winner = tree[node];
+        tree[node] = loser;
+      }
+    }
+    tree[0] = winner;
+  }
+
+  if (status == LOAD_SUCCESS)
+  {
+    status = write_lines (output, output_buffer, output_count);
+  }
+
+  free (readers);
+  free (tree);
+
+  return status;
+}
+
+/**
+ * Plays the tournament of the subtree at the given node, storing the loser
+ * of every match in its node.
+ *
+ * @return the run which won the subtree
+ */
+static int build_loser_tree (int *tree, int node, int count,
+                             const RunReader *readers, const SortSpec *spec)
+{
+  if (node >= count)
+  {
+    return node - count;
+  }
+
+  int left = build_loser_tree (tree, 2 * node, count, readers, spec);
+  int right = build_loser_tree (tree, (2 * node) + 1, count, readers, spec);
+
+  if (is_before (readers, left, right, spec))
+  {
+    tree[node] = right;
+    return left;
+  }
+
+  tree[node] = left;
+  return right;
+}
+
+/**
+ * Checks if the current bus line of the first run comes before the current
+ * bus line of the second one. An exhausted run comes after all others, and
+ * equal bus lines come in the order of their runs, which keeps the merge
+ * stable.
+ */
+static int is_before (const RunReader *readers, int first, int second,
+                      const SortSpec *spec)
+{
+  const BusLine *a = get_current (&readers[first]);
+  const BusLine *b = get_current (&readers[second]);
+
+  if (a == NULL || b == NULL)
+  {
+    return b == NULL && (a != NULL || first < second);
+  }
+
+  COUNT_COMPARISONS (1);
+  int result = compare_by_spec (a, b, spec);
+  return result < 0 || (result == 0 && first < second);
+}
+
+static const BusLine *get_current (const RunReader *reader)
+{
+  return reader->position < reader->count ? reader->buffer + reader->position
+                                          : NULL;
+}
+
+/**
+ * Refills the reader's buffer once all of its bus lines were taken.
+ *
+ * @return 1 upon success (including the end of the run), 0 on a read error
+ */
+static int advance_reader (RunReader *reader)
+{
+  if (reader->position < reader->count)
+  {
+    return 1;
+  }
+
+  reader->count = fread (reader->buffer, sizeof (BusLine), reader->capacity,
+                         reader->file);
+  reader->position = 0;
+
+  return !ferror (reader->file);
+}
+
+static LoadStatus write_lines (FILE *file, const BusLine *start, size_t count)
+{
+  if (count > 0 && fwrite (start, sizeof (BusLine), count, file) != count)
+  {
+    return LOAD_FILE_ERROR;
+  }
+
+  return LOAD_SUCCESS;
+}
+
+static int add_run (RunList *runs, FILE *file)
+{
+  if (runs->count == runs->capacity)
+  {
+    long capacity = runs->capacity == 0 ? EXTERNAL_MAX_FAN_IN
+                                        : runs->capacity * 2;
+    FILE **files = realloc (runs->files, sizeof (FILE *) * capacity);
+    if (files == NULL)
+    {
+      return 0;
+    }
+
+    runs->files = files;
+    runs->capacity = capacity;
+  }
+
+  runs->files[runs->count++] = file;
+  return 1;
+}
+
+/**
+ * Closes the given runs' files, which deletes them.
+ */
+static void close_runs (FILE **files, long count)
+{
+  for (long i = 0; i < count; i++)
+  {
+    fclose (files[i]);
+  }
+}
+
+/**
+ * Returns how many runs can be merged at once, each with (and the output) a
+ * buffer of at least EXTERNAL_MIN_BUFFER_LINES bus lines.
+ */
+static int get_fan_in (size_t memory_budget)
+{
+  size_t buffers = memory_budget
+                   / (sizeof (BusLine) * EXTERNAL_MIN_BUFFER_LINES);
+  size_t fan_in = buffers > 2 ? buffers - 1 : 2;
+
+  return fan_in < EXTERNAL_MAX_FAN_IN ? (int) fan_in : EXTERNAL_MAX_FAN_IN;
+}
+
+/**
+ * Checks whether the output path names the open input file itself.
+ */
+static int is_same_file (FILE *input, const char *output_path)
+{
+  struct stat input_stat, output_stat;
+  if (fstat (fileno (input), &input_stat) != 0
+      || stat (output_path, &output_stat) != 0)
+  {
+    // An output that doesn't exist yet is a new file
+    return 0;
+  }
+
+  return input_stat.st_dev == output_stat.st_dev
+         && input_stat.st_ino == output_stat.st_ino;
+}
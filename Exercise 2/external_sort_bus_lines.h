@@ -0,0 +1,65 @@
+#ifndef EX2_REPO_EXTERNALSORTBUSLINES_H
+#define EX2_REPO_EXTERNALSORTBUSLINES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "key_sort_bus_lines.h"
+#include "load_bus_lines.h"
+
+#define EXTERNAL_MIN_MEMORY (1024 * 1024)
+#define EXTERNAL_DEFAULT_MEMORY_MB 64
+
+// Memory sorting a single bus line of a run takes - the line itself, its
+// packed key, and its copy while the sorted lines are gathered
+#define EXTERNAL_BYTES_PER_LINE (2 * sizeof (BusLine) + sizeof (uint64_t))
+
+// Smallest buffer of every run in a merge, so reading the runs stays large
+// and sequential - when the budget can't give every run one, runs are
+// merged in several passes
+#define EXTERNAL_MIN_BUFFER_LINES 16384
+
+// Most runs merged at once, to keep the number of open files low
+#define EXTERNAL_MAX_FAN_IN 256
+
+/**
+ * What an external sort did.
+ */
+typedef struct ExternalSortStats
+{
+  long long lines; // Number of valid bus lines sorted
+  long runs; // Number of runs the input was split into
+  int merge_passes; // Number of passes over the data merging runs
+} ExternalSortStats;
+
+/**
+ * Sorts a binary file of bus lines (as written by save_bus_lines_binary)
+ * into another one, by the given specification, stably, within the given
+ * memory budget - so the file may be larger than the memory.
+ *
+ * The input is read in runs as large as the budget allows. Every run is
+ * validated like a loaded file, sorted with key_sort and written to a
+ * temporary file in the same packed binary format. The runs are then merged
+ * through a loser tree - a tournament tree which finds the next bus line out
+ * of K runs with log(K) comparisons - reading and writing through large
+ * buffers split from the same budget. When there are too many runs to give
+ * each a large buffer, groups of them are merged into longer runs first.
+ * An input that fits in a single run is sorted and written directly.
+ *
+ * @param input_path path of the binary file to sort
+ * @param output_path path of the sorted binary file, created or truncated -
+ *                    it may not be the input file
+ * @param spec the order to sort by
+ * @param memory_budget memory the sort may use, in bytes, at least
+ *                      EXTERNAL_MIN_MEMORY
+ * @param report filled with the input's rows
+ * @param stats filled with what the sort did
+ * @return LOAD_SUCCESS if the file was sorted, LOAD_FORMAT_ERROR if its size
+ *         isn't a whole number of bus lines, LOAD_FILE_ERROR if the output is
+ *         the input, another error otherwise
+ */
+LoadStatus external_sort (const char *input_path, const char *output_path,
+                          const SortSpec *spec, size_t memory_budget,
+                          LoadReport *report, ExternalSortStats *stats);
+
+#endif // EX2_REPO_EXTERNALSORTBUSLINES_H
@@ -0,0 +1,393 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "key_sort_bus_lines.h"
+
+#define SPEC_DELIMITER ','
+#define SPEC_DESCENDING '-'
+
+typedef struct KeyName
+{
+  const char *name;
+  SortKey key;
+} KeyName;
+
+static const KeyName key_names[] = {
+  { "line_number", SORT_BY_LINE_NUMBER },
+  { "distance", SORT_BY_DISTANCE },
+  { "duration", SORT_BY_DURATION },
+};
+
+static int get_bit_width (uint64_t value);
+static int merge_sort_by_spec (BusLine *start, BusLine *end,
+                               const SortSpec *spec);
+static void merge_sort_range (BusLine *start, BusLine *end, BusLine *buffer,
+                              const SortSpec *spec);
+static void sort_packed_loop (uint64_t *start, uint64_t *end,
+                              int depth_limit);
+static uint64_t *partition_packed (uint64_t *start, uint64_t *end);
+static void heap_sort_packed (uint64_t *start, uint64_t *end);
+static void sift_down_packed (uint64_t *start, size_t root, size_t length);
+static void swap_packed (uint64_t *a, uint64_t *b);
+
+int parse_sort_spec (const char *text, SortSpec *spec)
+{
+  spec->key_count = 0;
+
+  while (1)
+  {
+    if (spec->key_count == MAX_SORT_KEYS)
+    {
+      return 0;
+    }
+
+    int descending = *text == SPEC_DESCENDING;
+    text += descending;
+
+    const char *delimiter = strchr (text, SPEC_DELIMITER);
+    size_t length = delimiter == NULL ? strlen (text)
+                                      : (size_t) (delimiter - text);
+
+    int found = 0;
+    int name_count = sizeof (key_names) / sizeof (key_names[0]);
+    for (int i = 0; i < name_count && !found; i++)
+    {
+      if (strlen (key_names[i].name) == length
+          && strncmp (key_names[i].name, text, length) == 0)
+      {
+        spec->keys[spec->key_count] = key_names[i].key;
+        spec->descending[spec->key_count] = descending;
+        spec->key_count++;
+        found = 1;
+      }
+    }
+
+    if (!found)
+    {
+      return 0;
+    }
+
+    if (delimiter == NULL)
+    {
+      return 1;
+    }
+    text = delimiter + 1;
+  }
+}
+
+int key_sort (BusLine *start, BusLine *end, const SortSpec *spec)
+{
+  int length = get_number_of_elements (start, end);
+  if (length < 2)
+  {
+    return 1;
+  }
+
+  int mins[MAX_SORT_KEYS], maxs[MAX_SORT_KEYS], widths[MAX_SORT_KEYS];
+  size_t offsets[MAX_SORT_KEYS];
+
+  // The lowest bits hold the original index, which keeps the sort stable
+  // and lets the lines be gathered back from their keys.
+  int index_width = get_bit_width ((uint64_t) length - 1);
+  int total_width = index_width;
+
+  for (int k = 0; k < spec->key_count; k++)
+  {
+    get_key_range (start, end, spec->keys[k], &mins[k], &maxs[k]);
+    offsets[k] = get_key_offset (spec->keys[k]);
+    widths[k] = get_bit_width ((uint64_t) ((long long) maxs[k] - mins[k]));
+    total_width += widths[k];
+  }
+
+  if (total_width > PACKED_KEY_BITS)
+  {
+    return merge_sort_by_spec (start, end, spec);
+  }
+
+  uint64_t *keys = malloc (sizeof (uint64_t) * length);
+  BusLine *sorted = malloc (sizeof (BusLine) * length);
+  if (keys == NULL || sorted == NULL)
+  {
+    free (keys);
+    free (sorted);
+    return 0;
+  }
+
+  for (int i = 0; i < length; i++)
+  {
+    uint64_t key = 0;
+    for (int k = 0; k < spec->key_count; k++)
+    {
+      long long value = get_key_value (start + i, offsets[k]);
+      uint64_t part = (uint64_t) (spec->descending[k] ? maxs[k] - value
+                                                      : value - mins[k]);
+      key = (key << widths[k]) | part;
+    }
+
+    keys[i] = (key << index_width) | (uint64_t) i;
+  }
+
+  sort_packed_keys (keys, keys + length);
+
+  uint64_t index_mask = (((uint64_t) 1) << index_width) - 1;
+  for (int i = 0; i < length; i++)
+  {
+    sorted[i] = start[keys[i] & index_mask];
+  }
+
+  memcpy (start, sorted, sizeof (BusLine) * length);
+
+  free (keys);
+  free (sorted);
+  return 1;
+}
+
+int compare_by_spec (const BusLine *a, const BusLine *b,
+                     const SortSpec *spec)
+{
+  for (int k = 0; k < spec->key_count; k++)
+  {
+    size_t offset = get_key_offset (spec->keys[k]);
+    int first = get_key_value (a, offset);
+    int second = get_key_value (b, offset);
+
+    int result = (first > second) - (first < second);
+    if (result != 0)
+    {
+      return spec->descending[k] ? -result : result;
+    }
+  }
+
+  return 0;
+}
+
+void sort_packed_keys (uint64_t *start, uint64_t *end)
+{
+  int depth_limit = 0;
+  for (size_t n = (size_t) (end - start); n > 1; n >>= 1)
+  {
+    depth_limit += 2;
+  }
+
+  sort_packed_loop (start, end, depth_limit);
+
+  // A single insertion-sort pass over the ranges the loop left unsorted
+  for (uint64_t *current = start + 1; current < end; current++)
+  {
+    uint64_t value = *current;
+
+    uint64_t *hole = current;
+    while (hole > start && *(hole - 1) > value)
+    {
+      *hole = *(hole - 1);
+      hole--;
+    }
+
+    COUNT_COMPARISONS ((current - hole) + (hole > start));
+    *hole = value;
+  }
+}
+
+/**
+ * Returns the number of bits needed to hold the given value.
+ */
+static int get_bit_width (uint64_t value)
+{
+  int width = 0;
+  while (value != 0)
+  {
+    width++;
+    value >>= 1;
+  }
+
+  return width;
+}
+
+/**
+ * Sorts the array stably by comparing the fields of the given specification,
+ * for keys too wide to be packed.
+ *
+ * @return 1 if the array was sorted, 0 if memory allocation failed
+ */
+static int merge_sort_by_spec (BusLine *start, BusLine *end,
+                               const SortSpec *spec)
+{
+  BusLine *buffer = malloc (sizeof (BusLine)
+                            * get_number_of_elements (start, end));
+  if (buffer == NULL)
+  {
+    return 0;
+  }
+
+  merge_sort_range (start, end, buffer, spec);
+
+  free (buffer);
+  return 1;
+}
+
+static void merge_sort_range (BusLine *start, BusLine *end, BusLine *buffer,
+                              const SortSpec *spec)
+{
+  int length = get_number_of_elements (start, end);
+  if (length < 2)
+  {
+    return;
+  }
+
+  BusLine *middle = start + (length / 2);
+  merge_sort_range (start, middle, buffer, spec);
+  merge_sort_range (middle, end, buffer, spec);
+
+  // Merging from a copy of the left half, taking from it on ties.
+  int left_length = get_number_of_elements (start, middle);
+  memcpy (buffer, start, sizeof (BusLine) * left_length);
+
+  BusLine *left = buffer, *left_end = buffer + left_length;
+  BusLine *right = middle, *output = start;
+  BusLine *merged_start = output;
+  while (left < left_end && right < end)
+  {
+    *output++ = compare_by_spec (right, left, spec) < 0 ? *right++ : *left++;
+  }
+  COUNT_COMPARISONS (output - merged_start);
+
+  memcpy (output, left, sizeof (BusLine) * (left_end - left));
+}
+
+/**
+ * The recursive part of sort_packed_keys, leaving small ranges unsorted.
+ */
+static void sort_packed_loop (uint64_t *start, uint64_t *end,
+                              int depth_limit)
+{
+  while (end - start > INSERTION_SORT_THRESHOLD)
+  {
+    if (depth_limit == 0)
+    {
+      heap_sort_packed (start, end);
+      return;
+    }
+    depth_limit--;
+
+    uint64_t *mid = partition_packed (start, end);
+
+    if (mid - start < end - (mid + 1))
+    {
+      sort_packed_loop (start, mid, depth_limit);
+      start = mid + 1;
+    }
+    else
+    {
+      sort_packed_loop (mid + 1, end, depth_limit);
+      end = mid;
+    }
+  }
+}
+
+/**
+ * Hoare partitioning around the median of the first, middle and last keys.
+ *
+ * @return a pointer to the pivot which is now in the correct position
+ */
+static uint64_t *partition_packed (uint64_t *start, uint64_t *end)
+{
+  uint64_t *middle = start + ((end - start) / 2);
+  uint64_t *last = end - 1;
+
+  if (*middle < *start)
+  {
+    swap_packed (start, middle);
+  }
+  COUNT_COMPARISONS (2);
+  if (*last < *middle)
+  {
+    swap_packed (middle, last);
+    COUNT_COMPARISONS (1);
+    if (*middle < *start)
+    {
+      swap_packed (start, middle);
+    }
+  }
+
+  swap_packed (start, middle);
+  uint64_t pivot = *start;
+
+  uint64_t *i = start;
+  uint64_t *j = end;
+  while (1)
+  {
+    do
+    {
+      i++;
+    } while (i < end && *i < pivot);
+
+    do
+    {
+      j--;
+    } while (*j > pivot);
+
+    if (i >= j)
+    {
+      break;
+    }
+
+    swap_packed (i, j);
+  }
+
+  COUNT_COMPARISONS ((i - start) + (end - j));
+  swap_packed (start, j);
+
+  return j;
+}
+
+static void heap_sort_packed (uint64_t *start, uint64_t *end)
+{
+  size_t length = (size_t) (end - start);
+
+  for (size_t i = length / 2; i > 0; i--)
+  {
+    sift_down_packed (start, i - 1, length);
+  }
+
+  for (size_t i = length - 1; i > 0; i--)
+  {
+    swap_packed (start, start + i);
+    sift_down_packed (start, 0, i);
+  }
+}
+
+static void sift_down_packed (uint64_t *start, size_t root, size_t length)
+{
+  uint64_t value = start[root];
+
+  unsigned long long comparisons = 0;
+  size_t child = (2 * root) + 1;
+  while (child < length)
+  {
+    comparisons += 1 + (child + 1 < length);
+    if (child + 1 < length && start[child] < start[child + 1])
+    {
+      child++;
+    }
+
+    if (start[child] <= value)
+    {
+      break;
+    }
+
+    start[root] = start[child];
+    root = child;
+    child = (2 * root) + 1;
+  }
+
+  start[root] = value;
+  COUNT_COMPARISONS (comparisons);
+}
+
+static void swap_packed (uint64_t *a, uint64_t *b)
+{
+  COUNT_SWAPS (1);
+  uint64_t temp = *a;
+  *a = *b;
+  *b = temp;
+}
@@ -0,0 +1,74 @@
+#ifndef EX2_REPO_KEYSORTBUSLINES_H
+#define EX2_REPO_KEYSORTBUSLINES_H
+
+#include <stdint.h>
+
+#include "sort_bus_lines.h"
+
+#define MAX_SORT_KEYS 3
+#define PACKED_KEY_BITS 64
+
+/**
+ * A specification of the order to sort bus lines by - the first key decides,
+ * ties are broken by the second key, and so on. Lines equal on all keys keep
+ * their original order.
+ */
+typedef struct SortSpec
+{
+  SortKey keys[MAX_SORT_KEYS];
+  int descending[MAX_SORT_KEYS]; // Whether each key is sorted largest first
+  int key_count;
+} SortSpec;
+
+/**
+ * Parses a sort specification such as "duration,-distance,line_number".
+ * Keys are separated by commas, and a '-' before a key sorts it descending.
+ *
+ * @param text the specification to parse
+ * @param spec the specification to fill
+ * @return 1 if the specification is valid, 0 otherwise
+ */
+int parse_sort_spec (const char *text, SortSpec *spec);
+
+/**
+ * Sorts the array by the given specification, stably.
+ *
+ * Every bus line is compiled into a single packed 64-bit key - each field
+ * takes just enough bits for the range it spans in the array, the first key
+ * in the highest bits, and the line's original index in the lowest bits. The
+ * sort then compares single integers rather than fields, and moves 8 bytes
+ * per element rather than whole bus lines, and the lines are gathered into
+ * their places once at the end.
+ * Keys whose ranges don't fit in 64 bits are sorted by a merge-sort comparing
+ * the fields instead.
+ *
+ * @param start the start of the array to sort
+ * @param end the end of the array to sort
+ * @param spec the order to sort by
+ * @return 1 if the array was sorted, 0 if memory allocation failed (and the
+ *         array is unchanged)
+ */
+int key_sort (BusLine *start, BusLine *end, const SortSpec *spec);
+
+/**
+ * Compares 2 bus lines by the given specification.
+ *
+ * @param a the first bus line
+ * @param b the second bus line
+ * @param spec the order to compare by
+ * @return a negative value if a comes first, a positive value if b comes
+ *         first, 0 if they're equal on all keys
+ */
+int compare_by_spec (const BusLine *a, const BusLine *b,
+                     const SortSpec *spec);
+
+/**
+ * An implementation of the Quick-Sort algorithm over packed keys - an
+ * introsort just like quick_sort, on plain 64-bit integers.
+ *
+ * @param start the start of the keys to sort
+ * @param end the end of the keys to sort
+ */
+void sort_packed_keys (uint64_t *start, uint64_t *end);
+
+#endif // EX2_REPO_KEYSORTBUSLINES_H
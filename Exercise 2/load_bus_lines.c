@@ -0,0 +1,462 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "load_bus_lines.h"
+
+#define CSV_DELIMITER ','
+#define READ_CHUNK_SIZE (1024 * 1024)
+
+// A malformed row is kept in the array until validation with this line
+// number, which is never valid.
+#define MALFORMED_LINE_NUMBER INT_MIN
+
+// Enough digits for any valid value, while a longer number can't overflow
+
+#define STRINGIFY(value) #value
+#define TO_STRING(value) STRINGIFY (value)
+#define RANGE_MESSAGE(field, min, max)                                       \
+  field " should be an integer between " TO_STRING (min) " and "            \
+      TO_STRING (max) " (includes)"
+
+static LoadStatus read_file (const char *path, char **data, size_t *size,
+                             int *mapped);
+static LoadStatus read_stream (int fd, char **data, size_t *size);
+static void parse_rows (const char *data, size_t size, BusLine *start);
+static int parse_row (const char *cursor, const char *end, BusLine *line);
+static const char *scan_integer (const char *cursor, const char *end,
+                                 int *value);
+static const char *skip_blanks (const char *cursor, const char *end);
+static void add_bad_row (LoadReport *report, long row, RowError error);
+
+LoadStatus load_bus_lines_csv (const char *path, BusLines *lines,
+                               LoadReport *report)
+{
+  *lines = (BusLines) { NULL, NULL, NULL, 0 };
+  *report = (LoadReport) { 0, 0, 0, { { 0, ROW_MALFORMED } } };
+
+  char *data;
+  size_t size;
+  int mapped;
+  LoadStatus status = read_file (path, &data, &size, &mapped);
+  if (status != LOAD_SUCCESS)
+  {
+    return status;
+  }
+
+  // Counting the rows first, so the array is allocated once. A last row
+  // doesn't need to end with a newline.
+  long rows = 0;
+  for (const char *cursor = data; cursor < data + size; rows++)
+  {
+    const char *newline = memchr (cursor, '\n', (data + size) - cursor);
+    cursor = newline == NULL ? data + size : newline + 1;
+  }
+
+  if (rows > 0)
+  {
+    lines->start = malloc (sizeof (BusLine) * rows);
+    if (lines->start == NULL)
+    {
+      status = LOAD_ALLOCATION_ERROR;
+    }
+  }
+
+  if (status == LOAD_SUCCESS && rows > 0)
+  {
+    parse_rows (data, size, lines->start);
+
+    report->rows = rows;
+    lines->end = validate_bus_lines (lines->start, lines->start + rows,
+                                     report);
+  }
+
+  if (mapped)
+  {
+    munmap (data, size);
+  }
+  else
+  {
+    free (data);
+  }
+
+  return status;
+}
+
+LoadStatus load_bus_lines_binary (const char *path, BusLines *lines,
+                                  LoadReport *report)
+{
+  *lines = (BusLines) { NULL, NULL, NULL, 0 };
+  *report = (LoadReport) { 0, 0, 0, { { 0, ROW_MALFORMED } } };
+
+  int fd = open (path, O_RDONLY);
+  if (fd < 0)
+  {
+    return LOAD_FILE_ERROR;
+  }
+
+  struct stat file_stat;
+  if (fstat (fd, &file_stat) != 0 || !S_ISREG (file_stat.st_mode)
+      || (uintmax_t) file_stat.st_size > SIZE_MAX)
+  {
+    close (fd);
+    return LOAD_FILE_ERROR;
+  }
+
+  size_t size = (size_t) file_stat.st_size;
+  if (size % sizeof (BusLine) != 0)
+  {
+    close (fd);
+    return LOAD_FORMAT_ERROR;
+  }
+
+  // Mapping an empty file fails, but there's nothing to load anyway.
+  if (size == 0)
+  {
+    close (fd);
+    return LOAD_SUCCESS;
+  }
+
+  // A private writable mapping - only the pages that sorting or validation
+  // write to are copied, and the file itself is never changed.
+  void *mapping = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                        0);
+  close (fd);
+  if (mapping == MAP_FAILED)
+  {
+    return LOAD_FILE_ERROR;
+  }
+
+  lines->mapping = mapping;
+  lines->mapping_size = size;
+  lines->start = mapping;
+
+  report->rows = (long) (size / sizeof (BusLine));
+  lines->end = validate_bus_lines (lines->start,
+                                   lines->start + report->rows, report);
+
+  return LOAD_SUCCESS;
+}
+
+LoadStatus save_bus_lines_binary (const char *path, BusLine *start,
+                                  BusLine *end)
+{
+  FILE *file = fopen (path, "wb");
+  if (file == NULL)
+  {
+    return LOAD_FILE_ERROR;
+  }
+
+  size_t length = (size_t) get_number_of_elements (start, end);
+  int written = fwrite (start, sizeof (BusLine), length, file) == length;
+
+  return (fclose (file) == 0 && written) ? LOAD_SUCCESS : LOAD_FILE_ERROR;
+}
+
+BusLine *validate_bus_lines (BusLine *start, BusLine *end,
+                             LoadReport *report)
+{
+  BusLine *valid_end = start;
+
+  for (BusLine *current = start; current < end; current++)
+  {
+    // Comparing as unsigned checks both ends of a range at once.
+    int bad_line_number = (unsigned int) current->line_number - MIN_LINE_NUMBER
+                          > (unsigned int) (MAX_LINE_NUMBER - MIN_LINE_NUMBER);
+    int bad_distance = (unsigned int) current->distance - MIN_DISTANCE
+                       > (unsigned int) (MAX_DISTANCE - MIN_DISTANCE);
+    int bad_duration = (unsigned int) current->duration - MIN_DURATION
+                       > (unsigned int) (MAX_DURATION - MIN_DURATION);
+
+    if (bad_line_number | bad_distance | bad_duration)
+    {
+      RowError error = current->line_number == MALFORMED_LINE_NUMBER
+                           ? ROW_MALFORMED
+                       : bad_line_number ? ROW_BAD_LINE_NUMBER
+                       : bad_distance    ? ROW_BAD_DISTANCE
+                                         : ROW_BAD_DURATION;
+      add_bad_row (report, (long) (current - start) + 1, error);
+      continue;
+    }
+
+    // Writing only once rows were skipped, so a mapped array isn't copied
+    // when all of its rows are valid.
+    if (valid_end != current)
+    {
+      *valid_end = *current;
+    }
+    valid_end++;
+  }
+
+  return valid_end;
+}
+
+void release_bus_lines (BusLines *lines)
+{
+  if (lines->mapping != NULL)
+  {
+    munmap (lines->mapping, lines->mapping_size);
+  }
+  else
+  {
+    free (lines->start);
+  }
+
+  *lines = (BusLines) { NULL, NULL, NULL, 0 };
+}
+
+const char *get_load_status_message (LoadStatus status)
+{
+  switch (status)
+  {
+  case LOAD_SUCCESS:
+    return "Success";
+  case LOAD_FILE_ERROR:
+    return "The given file is invalid";
+  case LOAD_FORMAT_ERROR:
+    return "The given file is not an array of bus lines";
+  default:
+    return "Failed to allocate memory";
+  }
+}
+
+const char *get_row_error_message (RowError error)
+{
+  switch (error)
+  {
+  case ROW_BAD_LINE_NUMBER:
+    return RANGE_MESSAGE ("line_number", MIN_LINE_NUMBER, MAX_LINE_NUMBER);
+  case ROW_BAD_DISTANCE:
+    return RANGE_MESSAGE ("distance", MIN_DISTANCE, MAX_DISTANCE);
+  case ROW_BAD_DURATION:
+    return RANGE_MESSAGE ("duration", MIN_DURATION, MAX_DURATION);
+  default:
+    return "row should be 3 integers separated by commas";
+  }
+}
+
+/**
+ * Reads the whole file into memory - a regular file is mapped, anything
+ * else (a pipe, a terminal) is read until its end.
+ *
+ * @param path path of the file to read
+ * @param data set to the file's data
+ * @param size set to the size of the file's data
+ * @param mapped set to whether the data is mapped or allocated
+ * @return LOAD_SUCCESS if the file was read, an error otherwise
+ */
+static LoadStatus read_file (const char *path, char **data, size_t *size,
+                             int *mapped)
+{
+  *data = NULL;
+  *size = 0;
+  *mapped = 0;
+
+  int fd = open (path, O_RDONLY);
+  if (fd < 0)
+  {
+    return LOAD_FILE_ERROR;
+  }
+
+  struct stat file_stat;
+  if (fstat (fd, &file_stat) != 0)
+  {
+    close (fd);
+    return LOAD_FILE_ERROR;
+  }
+
+  LoadStatus status = LOAD_SUCCESS;
+  if (S_ISREG (file_stat.st_mode) && file_stat.st_size > 0
+      && (uintmax_t) file_stat.st_size <= SIZE_MAX)
+  {
+    *size = (size_t) file_stat.st_size;
+    *data = mmap (NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    *mapped = *data != MAP_FAILED;
+    if (*mapped)
+    {
+      posix_madvise (*data, *size, POSIX_MADV_SEQUENTIAL);
+    }
+  }
+
+  if (!*mapped)
+  {
+    status = read_stream (fd, data, size);
+  }
+
+  close (fd);
+  return status;
+}
+
+/**
+ * Reads the file until its end into a growing buffer.
+ */
+static LoadStatus read_stream (int fd, char **data, size_t *size)
+{
+  size_t capacity = 0;
+  *data = NULL;
+  *size = 0;
+
+  while (1)
+  {
+    if (*size == capacity)
+    {
+      capacity = capacity == 0 ? READ_CHUNK_SIZE : capacity * 2;
+      char *grown = realloc (*data, capacity);
+      if (grown == NULL)
+      {
+        free (*data);
+        *data = NULL;
+        return LOAD_ALLOCATION_ERROR;
+      }
+      *data = grown;
+    }
+
+    ssize_t length = read (fd, *data + *size, capacity - *size);
+    if (length == 0)
+    {
+      return LOAD_SUCCESS;
+    }
+    if (length < 0 && errno != EINTR)
+    {
+      free (*data);
+      *data = NULL;
+      return LOAD_FILE_ERROR;
+    }
+
+    *size += length > 0 ? (size_t) length : 0;
+  }
+}
+
+/**
+ * Parses every line of the data into a bus line of the array. A malformed
+ * line is parsed with MALFORMED_LINE_NUMBER, to be reported by validation.
+ */
+static void parse_rows (const char *data, size_t size, BusLine *start)
+{
+  const char *end = data + size;
+  BusLine *line = start;
+
+  for (const char *cursor = data; cursor < end; line++)
+  {
+    const char *newline = memchr (cursor, '\n', end - cursor);
+    const char *row_end = newline == NULL ? end : newline;
+
+    if (!parse_row (cursor, row_end, line))
+    {
+      line->line_number = MALFORMED_LINE_NUMBER;
+    }
+
+    cursor = row_end + 1;
+  }
+}
+
+/**
+ * Parses a single "line_number,distance,duration" row, allowing blanks
+ * around the numbers and a carriage return at its end.
+ *
+ * @return 1 if the row was parsed, 0 if it's malformed
+ */
+static int parse_row (const char *cursor, const char *end, BusLine *line)
+{
+  int *fields[] = { &line->line_number, &line->distance, &line->duration };
+  int field_count = sizeof (fields) / sizeof (fields[0]);
+
+  for (int i = 0; i < field_count; i++)
+  {
+    if (i > 0)
+    {
+      cursor = skip_blanks (cursor, end);
+      if (cursor == end || *cursor != CSV_DELIMITER)
+      {
+        return 0;
+      }
+      cursor++;
+    }
+
+    cursor = scan_integer (cursor, end, fields[i]);
+    if (cursor == NULL)
+    {
+      return 0;
+    }
+  }
+
+  return skip_blanks (cursor, end) == end;
+}
+
+/**
+ * Scans a decimal integer, with optional blanks and sign before it. Values
+ * too large for an int are clamped, so they fail validation (and never turn
+ * into MALFORMED_LINE_NUMBER), while leading zeros are read as they are.
+ *
+ * @param cursor where to start scanning
+ * @param end the end of the row
+ * @param value set to the scanned value
+ * @return a pointer past the integer, or NULL if there's no integer
+ */
+static const char *scan_integer (const char *cursor, const char *end,
+                                 int *value)
+{
+  cursor = skip_blanks (cursor, end);
+
+  int negative = 0;
+  if (cursor < end && (*cursor == '-' || *cursor == '+'))
+  {
+    negative = *cursor == '-';
+    cursor++;
+  }
+
+  const char *digits = cursor;
+  long long result = 0;
+  for (; cursor < end && *cursor >= '0' && *cursor <= '9'; cursor++)
+  {
+    // Past INT_MAX the value is clamped anyway, so it stops growing there
+    if (result <= INT_MAX)
+    {
+      result = (result * 10) + (*cursor - '0');
+    }
+  }
+
+  if (cursor == digits)
+  {
+    return NULL;
+  }
+
+  result = negative ? -result : result;
+  *value = result > INT_MAX   ? INT_MAX
+           : result < -INT_MAX ? -INT_MAX
+                               : (int) result;
+
+  return cursor;
+}
+
+/**
+ * Skips spaces, tabs and carriage returns.
+ */
+static const char *skip_blanks (const char *cursor, const char *end)
+{
+  while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+  {
+    cursor++;
+  }
+
+  return cursor;
+}
+
+static void add_bad_row (LoadReport *report, long row, RowError error)
+{
+  if (report->reported < MAX_REPORTED_ROWS)
+  {
+    report->bad[report->reported++] = (BadRow) { row, error };
+  }
+
+  report->bad_rows++;
+}
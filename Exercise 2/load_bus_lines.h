@@ -0,0 +1,136 @@
+#ifndef EX2_REPO_LOADBUSLINES_H
+#define EX2_REPO_LOADBUSLINES_H
+
+#include <stddef.h>
+
+#include "sort_bus_lines.h"
+
+// Number of bad rows a report keeps the details of
+#define MAX_REPORTED_ROWS 10
+
+typedef enum LoadStatus
+{
+  LOAD_SUCCESS,
+  LOAD_FILE_ERROR,
+  LOAD_FORMAT_ERROR,
+  LOAD_ALLOCATION_ERROR
+} LoadStatus;
+
+typedef enum RowError
+{
+  ROW_MALFORMED,
+  ROW_BAD_LINE_NUMBER,
+  ROW_BAD_DISTANCE,
+  ROW_BAD_DURATION
+} RowError;
+
+typedef struct BadRow
+{
+  long row; // Number of the row in the file, starting from 1
+  RowError error;
+} BadRow;
+
+/**
+ * The rows a file was loaded from - how many there were, how many were bad
+ * and skipped, and why the first MAX_REPORTED_ROWS of them were bad.
+ */
+typedef struct LoadReport
+{
+  long rows, bad_rows;
+  int reported;
+  BadRow bad[MAX_REPORTED_ROWS];
+} LoadReport;
+
+/**
+ * An array of bus lines, allocated or mapped from a file.
+ * Either way, it may be sorted in place and must be released with
+ * release_bus_lines.
+ */
+typedef struct BusLines
+{
+  BusLine *start, *end;
+  void *mapping; // The file's mapping, NULL for an allocated array
+  size_t mapping_size;
+} BusLines;
+
+/**
+ * Loads bus lines from a CSV file, with a "line_number,distance,duration"
+ * row per line.
+ *
+ * The whole file is read (mapped, when it's a regular file) and scanned at
+ * once by a hand-written integer scanner, without a call per row. The ranges
+ * of all rows are then validated in a single pass, and bad rows are skipped
+ * and reported rather than asked for again. Every line of the file is a row,
+ * so an empty line in the middle is bad as well.
+ *
+ * @param path path of the file to load
+ * @param lines set to the valid bus lines of the file
+ * @param report filled with the file's rows
+ * @return LOAD_SUCCESS if the file was loaded, an error otherwise
+ */
+LoadStatus load_bus_lines_csv (const char *path, BusLines *lines,
+                               LoadReport *report);
+
+/**
+ * Loads bus lines from a binary file - a packed array of BusLine structs, as
+ * written by save_bus_lines_binary.
+ *
+ * The file is mapped privately, so it's used as the array without copying,
+ * and sorting it never changes the file. Its rows are validated like a CSV
+ * file's.
+ *
+ * @param path path of the file to load
+ * @param lines set to the valid bus lines of the file
+ * @param report filled with the file's rows
+ * @return LOAD_SUCCESS if the file was loaded, LOAD_FORMAT_ERROR if its size
+ *         isn't a whole number of bus lines, another error otherwise
+ */
+LoadStatus load_bus_lines_binary (const char *path, BusLines *lines,
+                                  LoadReport *report);
+
+/**
+ * Saves bus lines into a binary file, to be loaded by load_bus_lines_binary
+ * on a machine of the same architecture.
+ *
+ * @param path path of the file, created or truncated
+ * @param start the start of the array to save
+ * @param end the end of the array to save
+ * @return LOAD_SUCCESS if the file was saved, LOAD_FILE_ERROR otherwise
+ */
+LoadStatus save_bus_lines_binary (const char *path, BusLine *start,
+                                  BusLine *end);
+
+/**
+ * Validates the ranges of all given bus lines, and moves the valid ones to
+ * the start of the array, keeping their order.
+ *
+ * @param start the start of the array to validate
+ * @param end the end of the array to validate
+ * @param report the report to add the bad rows to, numbered by their index
+ * @return the new end of the array, past its last valid bus line
+ */
+BusLine *validate_bus_lines (BusLine *start, BusLine *end,
+                             LoadReport *report);
+
+/**
+ * Releases the memory of the given bus lines.
+ *
+ * @param lines the bus lines to release
+ */
+void release_bus_lines (BusLines *lines);
+
+/**
+ * Returns a message describing the given status.
+ *
+ * @param status the status to describe
+ */
+const char *get_load_status_message (LoadStatus status);
+
+/**
+ * Returns a message describing why a row is bad.
+ *
+ * @param error the error of the row
+ */
+const char *get_row_error_message (RowError error);
+
+#endif // EX2_REPO_LOADBUSLINES_H
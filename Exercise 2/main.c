@@ -3,22 +3,43 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "bench_bus_lines.h"
+#include "external_sort_bus_lines.h"
+#include "key_sort_bus_lines.h"
+#include "load_bus_lines.h"
+#include "select_bus_lines.h"
 #include "sort_bus_lines.h"
 #include "test_bus_lines.h"
 
 #define BUFFER_LENGTH 60
 #define ARG_LENGTH 20
-
-#define MAX_LINE_NUMBER 999
-#define MIN_LINE_NUMER 1
-#define MAX_DISTANCE 1000
-#define MIN_DISTANCE 0
-#define MAX_DURATION 100
-#define MIN_DURATION 10
+#define ARG_COUNT_MODE 2
+#define ARG_COUNT_SORT 3
+#define ARG_COUNT_PACK 4
+#define ARG_COUNT_SELECT 4
+#define ARG_COUNT_FILE 2
+#define ARG_COUNT_BENCH 4
+#define ARG_COUNT_EXTERNAL 5
+#define ARG_COUNT_MEMORY 2
+#define BYTES_IN_MB (1024 * 1024)
 
 const char *test_result_format = "TEST %d %s: %s\n";
 
 bool check_arguments (int argc, char *argv[]);
+int get_mode_arg_count (char *mode);
+bool parse_select_arguments (char *key_arg, char *count_arg, SortKey *key,
+                             int *count);
+bool parse_bench_arguments (int argc, char *argv[], int *length,
+                            BenchPattern *pattern);
+bool parse_query_bench_arguments (int argc, char *argv[], int *length,
+                                  int *queries);
+bool parse_external_arguments (int argc, char *argv[], SortSpec *spec,
+                               size_t *memory_budget);
+bool get_bus_lines_file (char *format, char *path, BusLines *lines);
+void print_load_report (const LoadReport *report);
+bool run_pack (char *csv_path, char *binary_path);
+bool run_external_sort (char *input_path, char *output_path,
+                        const SortSpec *spec, size_t memory_budget);
 void get_number_of_bus_lines_input (int *number_of_bus_lines);
 bool get_bus_lines_input (BusLine **start, BusLine **end, int amount);
 void get_bus_line_input (BusLine *busLine);
@@ -29,6 +50,10 @@ bool check_line_data (char *line_info_raw, int *line_number, int *distance,
 
 void run_bubble_sort (BusLine *start, BusLine *end);
 void run_quick_sort (BusLine *start, BusLine *end);
+bool run_key_sort (BusLine *start, BusLine *end, const SortSpec *spec);
+void print_bus_lines (BusLine *start, BusLine *end);
+void run_top_k (BusLine *start, BusLine *end, SortKey key, int k);
+bool run_nth_element (BusLine *start, BusLine *end, SortKey key, int n);
 void run_tests (BusLine *start, BusLine *end);
 
 /**
@@ -38,6 +63,30 @@ void run_tests (BusLine *start, BusLine *end);
  * - use '<program_name> test' to run the application's test mode
  * - use '<program_name> bubble' to run the bubble sort mode
  * - use '<program_name> quick' to run the quick sort mode
+ * - use '<program_name> bench [<lines>] [<pattern>]' to run the benchmark
+ *   mode, on arrays of the given size and pattern (random, sorted, reversed,
+ *   sawtooth, few-unique, organ-pipe, appended or all)
+ * - use '<program_name> bench-partition [<lines>] [<pattern>]' to compare
+ *   the partitions of quick-sort, with the same patterns as bench
+ * - use '<program_name> bench-index [<lines>] [<queries>]' to run the route
+ *   index's query benchmark
+ * - use '<program_name> sort <keys>' to sort by the given keys, for example
+ *   'sort duration,-distance,line_number'
+ * - use '<program_name> top-k <key> <K>' to print only the K bus lines with
+ *   the smallest key, for example 'top-k duration 10'
+ * - use '<program_name> nth-element <key> <N>' to print only the bus line
+ *   that would be N-th if sorted by the key
+ * - use '<program_name> pack <csv> <binary>' to convert a CSV file of bus
+ *   lines into a binary one
+ * - use '<program_name> external <keys> <input> <output> [--mem <MB>]' to
+ *   sort a binary file of bus lines into another one, using at most the
+ *   given memory (EXTERNAL_DEFAULT_MEMORY_MB by default) - for files larger
+ *   than the memory
+ *
+ * The sorting modes (test, bubble, quick, sort, top-k and nth-element) ask for
+ * the bus lines one by one, unless followed by '--csv <path>' or
+ * '--binary <path>' - which load all bus lines from the given file, and
+ * report its bad rows.
  *
  * @param argc number of arguments inserted
  * @param argv array of arguments inserted
@@ -50,17 +99,80 @@ int main (int argc, char *argv[])
     return EXIT_FAILURE;
   }
 
-  int number_of_bus_lines = 0;
-  get_number_of_bus_lines_input (&number_of_bus_lines);
+  // The benchmark generates its own bus lines
+  if (strcmp (argv[1], "bench") == 0)
+  {
+    int length;
+    BenchPattern pattern;
+    parse_bench_arguments (argc, argv, &length, &pattern);
+
+    return run_benchmarks (length, pattern) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
 
-  BusLine start;
-  BusLine *start_p = &start, *end_p;
-  if (!get_bus_lines_input (&start_p, &end_p, number_of_bus_lines))
+  if (strcmp (argv[1], "bench-partition") == 0)
   {
-    free (start_p);
-    return EXIT_FAILURE;
+    int length;
+    BenchPattern pattern;
+    parse_bench_arguments (argc, argv, &length, &pattern);
+
+    return run_partition_benchmarks (length, pattern) ? EXIT_SUCCESS
+                                                      : EXIT_FAILURE;
+  }
+
+  if (strcmp (argv[1], "bench-index") == 0)
+  {
+    int length, queries;
+    parse_query_bench_arguments (argc, argv, &length, &queries);
+
+    return run_query_benchmarks (length, queries) ? EXIT_SUCCESS
+                                                  : EXIT_FAILURE;
+  }
+
+  if (strcmp (argv[1], "pack") == 0)
+  {
+    return run_pack (argv[2], argv[3]) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (strcmp (argv[1], "external") == 0)
+  {
+    SortSpec spec;
+    size_t memory_budget;
+    parse_external_arguments (argc, argv, &spec, &memory_budget);
+
+    return run_external_sort (argv[3], argv[4], &spec, memory_budget)
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+  }
+
+  BusLines lines;
+  int mode_arg_count = get_mode_arg_count (argv[1]);
+
+  if (argc > mode_arg_count)
+  {
+    if (!get_bus_lines_file (argv[mode_arg_count], argv[mode_arg_count + 1],
+                             &lines))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+  else
+  {
+    int number_of_bus_lines = 0;
+    get_number_of_bus_lines_input (&number_of_bus_lines);
+
+    BusLine start;
+    BusLine *start_p = &start, *end_p;
+    if (!get_bus_lines_input (&start_p, &end_p, number_of_bus_lines))
+    {
+      free (start_p);
+      return EXIT_FAILURE;
+    }
+
+    lines = (BusLines) { start_p, end_p, NULL, 0 };
   }
 
+  BusLine *start_p = lines.start, *end_p = lines.end;
+
   if (strcmp (argv[1], "bubble") == 0)
   {
     run_bubble_sort (start_p, end_p);
@@ -73,8 +185,35 @@ int main (int argc, char *argv[])
   {
     run_tests (start_p, end_p);
   }
+  else if (strcmp (argv[1], "sort") == 0)
+  {
+    SortSpec spec;
+    parse_sort_spec (argv[2], &spec);
 
-  free (start_p);
+    if (!run_key_sort (start_p, end_p, &spec))
+    {
+      release_bus_lines (&lines);
+      return EXIT_FAILURE;
+    }
+  }
+  else
+  {
+    SortKey key;
+    int count;
+    parse_select_arguments (argv[2], argv[3], &key, &count);
+
+    if (strcmp (argv[1], "top-k") == 0)
+    {
+      run_top_k (start_p, end_p, key, count);
+    }
+    else if (!run_nth_element (start_p, end_p, key, count))
+    {
+      release_bus_lines (&lines);
+      return EXIT_FAILURE;
+    }
+  }
+
+  release_bus_lines (&lines);
 
   return EXIT_SUCCESS;
 }
@@ -88,18 +227,357 @@ int main (int argc, char *argv[])
  */
 bool check_arguments (int argc, char *argv[])
 {
-  if (argc != 2
-      || (strcmp (argv[1], "bubble") != 0 && strcmp (argv[1], "quick") != 0
-          && strcmp (argv[1], "test") != 0))
+  if (argc == ARG_COUNT_PACK && strcmp (argv[1], "pack") == 0)
+  {
+    return true;
+  }
+
+  if (argc >= ARG_COUNT_MODE && argc <= ARG_COUNT_BENCH
+      && (strcmp (argv[1], "bench") == 0
+          || strcmp (argv[1], "bench-partition") == 0))
+  {
+    int length;
+    BenchPattern pattern;
+    if (!parse_bench_arguments (argc, argv, &length, &pattern))
+    {
+      printf ("USAGE: %s takes an optional positive number of lines and "
+              "an optional pattern: random, sorted, reversed, sawtooth, "
+              "few-unique, organ-pipe, appended or all\n",
+              argv[1]);
+      return false;
+    }
+
+    return true;
+  }
+
+  if (argc >= ARG_COUNT_MODE && argc <= ARG_COUNT_BENCH
+      && strcmp (argv[1], "bench-index") == 0)
+  {
+    int length, queries;
+    if (!parse_query_bench_arguments (argc, argv, &length, &queries))
+    {
+      printf ("USAGE: bench-index takes an optional positive number of lines "
+              "and an optional positive number of queries\n");
+      return false;
+    }
+
+    return true;
+  }
+
+  if (argc >= ARG_COUNT_MODE && strcmp (argv[1], "external") == 0)
+  {
+    SortSpec spec;
+    size_t memory_budget;
+    if (!parse_external_arguments (argc, argv, &spec, &memory_budget))
+    {
+      printf ("USAGE: external takes sort keys, an input and an output "
+              "binary file, and optionally '--mem <MB>' of at least 1 MB\n");
+      return false;
+    }
+
+    return true;
+  }
+
+  int mode_arg_count = argc < ARG_COUNT_MODE ? 0 : get_mode_arg_count (argv[1]);
+  bool has_file = argc == mode_arg_count + ARG_COUNT_FILE
+                  && (strcmp (argv[mode_arg_count], "--csv") == 0
+                      || strcmp (argv[mode_arg_count], "--binary") == 0);
+
+  if (mode_arg_count == 0 || (argc != mode_arg_count && !has_file))
   {
     printf ("USAGE: please execute the program with a signle argument: "
-            "<test/bubble/quick>\n");
+            "<test/bubble/quick>, with 'bench [<lines>] [<pattern>]', "
+            "'bench-partition [<lines>] [<pattern>]', "
+            "'bench-index [<lines>] [<queries>]', "
+            "'sort <keys>', "
+            "'top-k <key> <K>', 'nth-element <key> <N>' or "
+            "'pack <csv> <binary>' or "
+            "'external <keys> <input> <output> [--mem <MB>]'. "
+            "Sorting modes may be followed by "
+            "'--csv <path>' or '--binary <path>'\n");
+    return false;
+  }
+
+  SortSpec spec;
+  if (strcmp (argv[1], "sort") == 0 && !parse_sort_spec (argv[2], &spec))
+  {
+    printf ("USAGE: sort keys should be up to %d of line_number, distance "
+            "and duration, separated by commas\n",
+            MAX_SORT_KEYS);
+    return false;
+  }
+
+  SortKey key;
+  int count;
+  if (mode_arg_count == ARG_COUNT_SELECT
+      && !parse_select_arguments (argv[2], argv[3], &key, &count))
+  {
+    printf ("USAGE: %s should be followed by one of line_number, distance "
+            "and duration, and by a positive integer\n",
+            argv[1]);
     return false;
   }
 
   return true;
 }
 
+/**
+ * Parses the key and count of the top-k and nth-element modes.
+ *
+ * @param key_arg the key argument
+ * @param count_arg the count argument
+ * @param key set to the parsed key
+ * @param count set to the parsed count
+ * @return true if both arguments are valid, false otherwise
+ */
+bool parse_select_arguments (char *key_arg, char *count_arg, SortKey *key,
+                             int *count)
+{
+  SortSpec spec;
+  if (!parse_sort_spec (key_arg, &spec) || spec.key_count != 1
+      || spec.descending[0])
+  {
+    return false;
+  }
+  *key = spec.keys[0];
+
+  char extra;
+  return sscanf (count_arg, "%d%c", count, &extra) == 1 && (*count) > 0;
+}
+
+/**
+ * Parses the optional arguments of the benchmark mode - the number of lines
+ * in each array, and the pattern of the arrays.
+ *
+ * @param argc number of arguments given
+ * @param argv given arguments values
+ * @param length set to the number of lines, BENCH_LENGTH by default
+ * @param pattern set to the pattern, all of them (PATTERN_COUNT) by default
+ * @return true if the arguments are valid, false otherwise
+ */
+bool parse_bench_arguments (int argc, char *argv[], int *length,
+                            BenchPattern *pattern)
+{
+  *length = BENCH_LENGTH;
+  *pattern = PATTERN_COUNT;
+
+  char extra;
+  if (argc > ARG_COUNT_MODE
+      && (sscanf (argv[ARG_COUNT_MODE], "%d%c", length, &extra) != 1
+          || (*length) <= 0))
+  {
+    return false;
+  }
+
+  return argc <= ARG_COUNT_MODE + 1
+         || parse_pattern (argv[ARG_COUNT_MODE + 1], pattern);
+}
+
+/**
+ * Parses the optional arguments of the query benchmark mode - the number of
+ * lines to index, and the number of queries.
+ *
+ * @param argc number of arguments given
+ * @param argv given arguments values
+ * @param length set to the number of lines, QUERY_BENCH_LENGTH by default
+ * @param queries set to the number of queries, QUERY_BENCH_COUNT by default
+ * @return true if the arguments are valid, false otherwise
+ */
+bool parse_query_bench_arguments (int argc, char *argv[], int *length,
+                                  int *queries)
+{
+  *length = QUERY_BENCH_LENGTH;
+  *queries = QUERY_BENCH_COUNT;
+
+  char extra;
+  if (argc > ARG_COUNT_MODE
+      && (sscanf (argv[ARG_COUNT_MODE], "%d%c", length, &extra) != 1
+          || (*length) <= 0))
+  {
+    return false;
+  }
+
+  return argc <= ARG_COUNT_MODE + 1
+         || (sscanf (argv[ARG_COUNT_MODE + 1], "%d%c", queries, &extra) == 1
+             && (*queries) > 0);
+}
+
+/**
+ * Parses the arguments of the external sort mode - the keys to sort by, and
+ * the optional memory budget.
+ *
+ * @param argc number of arguments given
+ * @param argv given arguments values
+ * @param spec set to the keys to sort by
+ * @param memory_budget set to the memory budget in bytes,
+ *                      EXTERNAL_DEFAULT_MEMORY_MB by default
+ * @return true if the arguments are valid, false otherwise
+ */
+bool parse_external_arguments (int argc, char *argv[], SortSpec *spec,
+                               size_t *memory_budget)
+{
+  int megabytes = EXTERNAL_DEFAULT_MEMORY_MB;
+
+  char extra;
+  if (argc == ARG_COUNT_EXTERNAL + ARG_COUNT_MEMORY)
+  {
+    if (strcmp (argv[ARG_COUNT_EXTERNAL], "--mem") != 0
+        || sscanf (argv[ARG_COUNT_EXTERNAL + 1], "%d%c", &megabytes, &extra)
+               != 1
+        || megabytes < EXTERNAL_MIN_MEMORY / BYTES_IN_MB)
+    {
+      return false;
+    }
+  }
+  else if (argc != ARG_COUNT_EXTERNAL)
+  {
+    return false;
+  }
+
+  *memory_budget = (size_t) megabytes * BYTES_IN_MB;
+  return parse_sort_spec (argv[2], spec);
+}
+
+/**
+ * Returns the number of arguments the given sorting mode takes, including
+ * the program's name.
+ *
+ * @param mode the mode to check
+ * @return the number of arguments, or 0 if it's not a sorting mode
+ */
+int get_mode_arg_count (char *mode)
+{
+  if (strcmp (mode, "sort") == 0)
+  {
+    return ARG_COUNT_SORT;
+  }
+
+  if (strcmp (mode, "top-k") == 0 || strcmp (mode, "nth-element") == 0)
+  {
+    return ARG_COUNT_SELECT;
+  }
+
+  if (strcmp (mode, "bubble") == 0 || strcmp (mode, "quick") == 0
+      || strcmp (mode, "test") == 0)
+  {
+    return ARG_COUNT_MODE;
+  }
+
+  return 0;
+}
+
+/**
+ * Loads all bus lines from the given file, and reports its bad rows.
+ *
+ * @param format '--csv' or '--binary'
+ * @param path path of the file
+ * @param lines set to the valid bus lines of the file
+ * @return true if the file was loaded, false otherwise
+ */
+bool get_bus_lines_file (char *format, char *path, BusLines *lines)
+{
+  LoadReport report;
+  LoadStatus status = strcmp (format, "--csv") == 0
+                          ? load_bus_lines_csv (path, lines, &report)
+                          : load_bus_lines_binary (path, lines, &report);
+
+  if (status != LOAD_SUCCESS)
+  {
+    printf ("ERROR: %s\n", get_load_status_message (status));
+    return false;
+  }
+
+  print_load_report (&report);
+  return true;
+}
+
+/**
+ * Prints the bad rows of a loaded file, if there were any.
+ *
+ * @param report the report of the file
+ */
+void print_load_report (const LoadReport *report)
+{
+  for (int i = 0; i < report->reported; i++)
+  {
+    printf ("ERROR: row %ld: %s\n", report->bad[i].row,
+            get_row_error_message (report->bad[i].error));
+  }
+
+  if (report->bad_rows > report->reported)
+  {
+    printf ("ERROR: and %ld more bad rows\n",
+            report->bad_rows - report->reported);
+  }
+
+  if (report->bad_rows > 0)
+  {
+    printf ("ERROR: skipped %ld of %ld rows\n", report->bad_rows,
+            report->rows);
+  }
+}
+
+/**
+ * Runs the pack mode of the application - converts a CSV file of bus lines
+ * into a binary one, without its bad rows.
+ *
+ * @param csv_path path of the CSV file
+ * @param binary_path path of the binary file
+ * @return true if the file was converted, false otherwise
+ */
+bool run_pack (char *csv_path, char *binary_path)
+{
+  BusLines lines;
+  if (!get_bus_lines_file ("--csv", csv_path, &lines))
+  {
+    return false;
+  }
+
+  LoadStatus status = save_bus_lines_binary (binary_path, lines.start,
+                                             lines.end);
+  release_bus_lines (&lines);
+
+  if (status != LOAD_SUCCESS)
+  {
+    printf ("ERROR: %s\n", get_load_status_message (status));
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Runs the external sort mode of the application - sorts a binary file of
+ * bus lines into another one within the memory budget, and reports its bad
+ * rows and how it was sorted.
+ *
+ * @param input_path path of the binary file to sort
+ * @param output_path path of the sorted binary file
+ * @param spec the keys to sort by
+ * @param memory_budget memory the sort may use, in bytes
+ * @return true if the file was sorted, false otherwise
+ */
+bool run_external_sort (char *input_path, char *output_path,
+                        const SortSpec *spec, size_t memory_budget)
+{
+  LoadReport report;
+  ExternalSortStats stats;
+  LoadStatus status = external_sort (input_path, output_path, spec,
+                                     memory_budget, &report, &stats);
+
+  if (status != LOAD_SUCCESS)
+  {
+    printf ("ERROR: %s\n", get_load_status_message (status));
+    return false;
+  }
+
+  print_load_report (&report);
+  printf ("Sorted %lld bus lines in %ld runs and %d merge passes\n",
+          stats.lines, stats.runs, stats.merge_passes);
+
+  return true;
+}
+
 /**
  * Asks the user for the number of bus lines to be sorted.
  * It keeps on asking the user for an input until the received input is valid.
@@ -182,7 +660,7 @@ void get_bus_line_input (BusLine *busLine)
     {
       continue;
     }
-  } while (line_number < MIN_LINE_NUMER || line_number > MAX_LINE_NUMBER
+  } while (line_number < MIN_LINE_NUMBER || line_number > MAX_LINE_NUMBER
            || distance < MIN_DISTANCE || distance > MAX_DISTANCE
            || duration < MIN_DURATION || duration > MAX_DURATION);
 
@@ -199,7 +677,7 @@ bool get_line_info (char *line_info_raw)
   {
     printf ("ERROR: line_number should be an integer between %d and %d "
             "(includes)\n",
-            MIN_LINE_NUMER, MAX_LINE_NUMBER);
+            MIN_LINE_NUMBER, MAX_LINE_NUMBER);
     return false;
   }
 
@@ -212,12 +690,12 @@ bool check_line_data (char *line_info_raw, int *line_number, int *distance,
   int result
       = sscanf (line_info_raw, "%d,%d,%d", line_number, distance, duration);
 
-  if (result == EOF || (*line_number) < MIN_LINE_NUMER
+  if (result == EOF || (*line_number) < MIN_LINE_NUMBER
       || (*line_number) > MAX_LINE_NUMBER)
   {
     printf ("ERROR: line_number should be an integer between %d and %d "
             "(includes)\n",
-            MIN_LINE_NUMER, MAX_LINE_NUMBER);
+            MIN_LINE_NUMBER, MAX_LINE_NUMBER);
     return false;
   }
   else if ((*distance) < MIN_DISTANCE || (*distance) > MAX_DISTANCE)
@@ -248,11 +726,7 @@ bool check_line_data (char *line_info_raw, int *line_number, int *distance,
 void run_bubble_sort (BusLine *start, BusLine *end)
 {
   bubble_sort (start, end);
-  for (int i = 0; i < get_number_of_elements (start, end); i++)
-  {
-    printf ("%d,%d,%d\n", (*(start + i)).line_number, (*(start + i)).distance,
-            (*(start + i)).duration);
-  }
+  print_bus_lines (start, end);
 }
 
 /**
@@ -265,6 +739,80 @@ void run_bubble_sort (BusLine *start, BusLine *end)
 void run_quick_sort (BusLine *start, BusLine *end)
 {
   quick_sort (start, end);
+  print_bus_lines (start, end);
+}
+
+/**
+ * Runs the key sort mode of the application - sorts the given array by the
+ * given keys.
+ *
+ * @param start start of the array to sort
+ * @param end end of the array to sort
+ * @param spec keys to sort by
+ * @return true if the array was sorted, false if memory allocation failed
+ */
+bool run_key_sort (BusLine *start, BusLine *end, const SortSpec *spec)
+{
+  if (!key_sort (start, end, spec))
+  {
+    printf ("ERROR: Failed to allocate memory\n");
+    return false;
+  }
+
+  print_bus_lines (start, end);
+  return true;
+}
+
+/**
+ * Runs the top-k mode of the application - prints only the ${k} bus lines
+ * with the smallest key, sorted. Prints all of them if there are fewer.
+ *
+ * @param start start of the array to select from
+ * @param end end of the array to select from
+ * @param key the field to select by
+ * @param k number of bus lines to print
+ */
+void run_top_k (BusLine *start, BusLine *end, SortKey key, int k)
+{
+  int length = get_number_of_elements (start, end);
+  k = k < length ? k : length;
+
+  top_k (start, end, k, key);
+  print_bus_lines (start, start + k);
+}
+
+/**
+ * Runs the nth-element mode of the application - prints only the bus line
+ * that would be ${n}-th if the array was sorted by the given key.
+ *
+ * @param start start of the array to select from
+ * @param end end of the array to select from
+ * @param key the field to select by
+ * @param n position of the bus line to print, starting from 1
+ * @return true if there are at least ${n} bus lines, false otherwise
+ */
+bool run_nth_element (BusLine *start, BusLine *end, SortKey key, int n)
+{
+  int length = get_number_of_elements (start, end);
+  if (n > length)
+  {
+    printf ("ERROR: N should be at most the number of lines (%d)\n", length);
+    return false;
+  }
+
+  nth_element (start, start + n - 1, end, key);
+  print_bus_lines (start + n - 1, start + n);
+  return true;
+}
+
+/**
+ * Prints all bus lines between start and end, one per line.
+ *
+ * @param start start of the array to print
+ * @param end end of the array to print
+ */
+void print_bus_lines (BusLine *start, BusLine *end)
+{
   for (int i = 0; i < get_number_of_elements (start, end); i++)
   {
     printf ("%d,%d,%d\n", (*(start + i)).line_number, (*(start + i)).distance,
@@ -273,7 +821,7 @@ void run_quick_sort (BusLine *start, BusLine *end)
 }
 
 /**
- * Runs the test mode of the application - runs 4 different tests
+ * Runs the test mode of the application - runs 5 different tests
  *
  * @param start start of the array to test
  * @param end end of the array to test
@@ -299,4 +847,9 @@ void run_tests (BusLine *start, BusLine *end)
   printf (test_result_format, 4, test_res ? "PASSED" : "FAILED",
           test_res ? "The array has the same items after sorting"
                    : "The array does not have the same items after sorting");
+
+  test_res = test_load_bus_lines_csv ();
+  printf (test_result_format, 5, test_res ? "PASSED" : "FAILED",
+          test_res ? "The CSV loader reads every field as written"
+                   : "The CSV loader misreads a field");
 }
\ No newline at end of file
@@ -0,0 +1,354 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "key_sort_bus_lines.h"
+#include "parallel_sort_bus_lines.h"
+
+typedef void *(*task_function) (void *arg);
+
+/**
+ * A task running on a thread of its own, which hands its thread's counters
+ * back to the calling thread.
+ */
+typedef struct ThreadTask
+{
+  task_function function;
+  void *task;
+  SortCounters counters;
+} ThreadTask;
+
+/**
+ * Sorting a single run of the array.
+ */
+typedef struct SortTask
+{
+  BusLine *start, *end;
+  int stable;
+  int sorted; // Whether the run was sorted (stable sorts may fail to allocate)
+} SortTask;
+
+/**
+ * Merging a slice of the output of 2 adjacent runs.
+ */
+typedef struct MergeTask
+{
+  const BusLine *left, *right;
+  int left_length, right_length;
+  BusLine *output;
+  int output_start, output_end; // Slice of the merged output to produce
+} MergeTask;
+
+static int sort_runs (BusLine *start, BusLine *end, int threads, int stable);
+static int sort_sequential (BusLine *start, BusLine *end, int stable);
+static void *sort_run (void *arg);
+static void *merge_slice (void *arg);
+static int find_split (const BusLine *left, int left_length,
+                       const BusLine *right, int right_length, int diagonal);
+static void run_tasks (task_function function, void *tasks, size_t task_size,
+                       int count);
+static void *run_thread_task (void *arg);
+
+int parallel_sort (BusLine *start, BusLine *end, int threads)
+{
+  return sort_runs (start, end, threads, 0);
+}
+
+int parallel_stable_sort (BusLine *start, BusLine *end, int threads)
+{
+  return sort_runs (start, end, threads, 1);
+}
+
+int get_processor_count (void)
+{
+  long count = sysconf (_SC_NPROCESSORS_ONLN);
+  return count < 1 ? 1 : (int) count;
+}
+
+/**
+ * Sorts the array - sorts a run per thread, then merges the runs in rounds,
+ * back and forth between the array and a buffer.
+ *
+ * @return 1 if the array was sorted, 0 if memory allocation failed
+ */
+static int sort_runs (BusLine *start, BusLine *end, int threads, int stable)
+{
+  int length = get_number_of_elements (start, end);
+  threads = threads > PARALLEL_SORT_MAX_THREADS ? PARALLEL_SORT_MAX_THREADS
+                                                : threads;
+
+  if (threads <= 1 || length < PARALLEL_SORT_MIN_LENGTH)
+  {
+    return sort_sequential (start, end, stable);
+  }
+
+  BusLine *buffer = malloc (sizeof (BusLine) * length);
+  SortTask *sort_tasks = malloc (sizeof (SortTask) * threads);
+  MergeTask *merge_tasks = malloc (sizeof (MergeTask) * threads);
+  int *bounds = malloc (sizeof (int) * (threads + 1));
+  if (buffer == NULL || sort_tasks == NULL || merge_tasks == NULL
+      || bounds == NULL)
+  {
+    free (buffer);
+    free (sort_tasks);
+    free (merge_tasks);
+    free (bounds);
+    return sort_sequential (start, end, stable);
+  }
+
+  int runs = threads;
+  for (int i = 0; i <= runs; i++)
+  {
+    bounds[i] = (int) (((long long) length * i) / runs);
+  }
+
+  for (int i = 0; i < runs; i++)
+  {
+    sort_tasks[i] = (SortTask) { start + bounds[i], start + bounds[i + 1],
+                                 stable, 0 };
+  }
+
+  run_tasks (&sort_run, sort_tasks, sizeof (SortTask), runs);
+
+  int sorted = 1;
+  for (int i = 0; i < runs; i++)
+  {
+    sorted = sorted && sort_tasks[i].sorted;
+  }
+
+  // The runs are merged from source into target, which swap every round.
+  BusLine *source = start, *target = buffer;
+  while (sorted && runs > 1)
+  {
+    int pairs = runs / 2;
+    int tasks_per_pair = threads / pairs;
+    int task_count = 0;
+
+    for (int pair = 0; pair < pairs; pair++)
+    {
+      int left = bounds[2 * pair], middle = bounds[(2 * pair) + 1];
+      int right = bounds[(2 * pair) + 2];
+
+      for (int t = 0; t < tasks_per_pair; t++)
+      {
+        int merged_length = right - left;
+        merge_tasks[task_count++] = (MergeTask) {
+          .left = source + left,
+          .right = source + middle,
+          .left_length = middle - left,
+          .right_length = right - middle,
+          .output = target + left,
+          .output_start
+          = (int) (((long long) merged_length * t) / tasks_per_pair),
+          .output_end
+          = (int) (((long long) merged_length * (t + 1)) / tasks_per_pair),
+        };
+      }
+    }
+
+    // An odd run out is carried over to the target as is.
+    if (runs % 2 == 1)
+    {
+      int left = bounds[runs - 1];
+      memcpy (target + left, source + left,
+              sizeof (BusLine) * (bounds[runs] - left));
+    }
+
+    run_tasks (&merge_slice, merge_tasks, sizeof (MergeTask), task_count);
+
+    for (int i = 0; i <= pairs; i++)
+    {
+      bounds[i] = bounds[2 * i];
+    }
+    if (runs % 2 == 1)
+    {
+      bounds[pairs + 1] = bounds[runs];
+    }
+    runs = pairs + (runs % 2);
+
+    BusLine *temp = source;
+    source = target;
+    target = temp;
+  }
+
+  if (sorted && source != start)
+  {
+    memcpy (start, source, sizeof (BusLine) * length);
+  }
+
+  free (buffer);
+  free (sort_tasks);
+  free (merge_tasks);
+  free (bounds);
+
+  return sorted;
+}
+
+/**
+ * Sorts the array on the calling thread. The stable sort counting-sorts a
+ * small range of durations, and otherwise goes through packed keys, which
+ * carry every line's index.
+ */
+static int sort_sequential (BusLine *start, BusLine *end, int stable)
+{
+  if (!stable)
+  {
+    quick_sort (start, end);
+    return 1;
+  }
+
+  if (should_counting_sort (start, end, SORT_BY_DURATION)
+      && counting_sort (start, end, SORT_BY_DURATION))
+  {
+    return 1;
+  }
+
+  SortSpec spec = { { SORT_BY_DURATION }, { 0 }, 1 };
+  return key_sort (start, end, &spec);
+}
+
+/**
+ * Sorts a single run.
+ *
+ * @param arg pointer to the run's SortTask
+ * @return NULL
+ */
+static void *sort_run (void *arg)
+{
+  SortTask *task = arg;
+  task->sorted = sort_sequential (task->start, task->end, task->stable);
+
+  return NULL;
+}
+
+/**
+ * Merges a slice of the output of 2 runs. Taking from the left run on ties
+ * keeps the merge stable.
+ *
+ * @param arg pointer to the slice's MergeTask
+ * @return NULL
+ */
+static void *merge_slice (void *arg)
+{
+  MergeTask *task = arg;
+
+  int i = find_split (task->left, task->left_length, task->right,
+                      task->right_length, task->output_start);
+  int j = task->output_start - i;
+  int left_end = find_split (task->left, task->left_length, task->right,
+                             task->right_length, task->output_end);
+  int right_end = task->output_end - left_end;
+
+  BusLine *output = task->output + task->output_start;
+  COUNT_COMPARISONS ((left_end - i) + (right_end - j));
+  while (i < left_end && j < right_end)
+  {
+    if (task->right[j].duration < task->left[i].duration)
+    {
+      *output++ = task->right[j++];
+    }
+    else
+    {
+      *output++ = task->left[i++];
+    }
+  }
+
+  memcpy (output, task->left + i, sizeof (BusLine) * (left_end - i));
+  output += left_end - i;
+  memcpy (output, task->right + j, sizeof (BusLine) * (right_end - j));
+
+  return NULL;
+}
+
+/**
+ * Finds how many of the first ${diagonal} elements of the merged output come
+ * from the left run, with a binary search along the merge path.
+ *
+ * @return the number of elements taken from the left run
+ */
+static int find_split (const BusLine *left, int left_length,
+                       const BusLine *right, int right_length, int diagonal)
+{
+  int low = diagonal > right_length ? diagonal - right_length : 0;
+  int high = diagonal < left_length ? diagonal : left_length;
+
+  // Looking for the smallest i where left[i] comes after right[diagonal-i-1]
+  while (low < high)
+  {
+    COUNT_COMPARISONS (1);
+    int i = low + ((high - low) / 2);
+    if (left[i].duration <= right[diagonal - i - 1].duration)
+    {
+      low = i + 1;
+    }
+    else
+    {
+      high = i;
+    }
+  }
+
+  return low;
+}
+
+/**
+ * Runs every task on its own thread, the last one on the calling thread.
+ * A task whose thread can't be created runs on the calling thread as well.
+ * The counters of all threads are added to the calling thread's.
+ *
+ * @param function function to run every task with
+ * @param tasks array of the tasks
+ * @param task_size size of a single task
+ * @param count number of tasks
+ */
+static void run_tasks (task_function function, void *tasks, size_t task_size,
+                       int count)
+{
+  pthread_t threads[PARALLEL_SORT_MAX_THREADS];
+  ThreadTask thread_tasks[PARALLEL_SORT_MAX_THREADS];
+  int created[PARALLEL_SORT_MAX_THREADS] = { 0 };
+
+  for (int i = 0; i < count - 1; i++)
+  {
+    thread_tasks[i] = (ThreadTask) { function,
+                                     (char *) tasks + (i * task_size),
+                                     { 0, 0 } };
+    created[i] = pthread_create (&threads[i], NULL, &run_thread_task,
+                                 &thread_tasks[i])
+                 == 0;
+    if (!created[i])
+    {
+      function (thread_tasks[i].task);
+    }
+  }
+
+  function ((char *) tasks + ((count - 1) * task_size));
+
+  for (int i = 0; i < count - 1; i++)
+  {
+    if (created[i])
+    {
+      pthread_join (threads[i], NULL);
+      sort_counters.comparisons += thread_tasks[i].counters.comparisons;
+      sort_counters.swaps += thread_tasks[i].counters.swaps;
+    }
+  }
+}
+
+/**
+ * Runs a task on a new thread, whose counters start from zero.
+ *
+ * @param arg pointer to the ThreadTask
+ * @return NULL
+ */
+static void *run_thread_task (void *arg)
+{
+  ThreadTask *thread_task = arg;
+
+  thread_task->function (thread_task->task);
+  thread_task->counters = sort_counters;
+
+  return NULL;
+}
@@ -0,0 +1,45 @@
+#ifndef EX2_REPO_PARALLELSORTBUSLINES_H
+#define EX2_REPO_PARALLELSORTBUSLINES_H
+
+#include "sort_bus_lines.h"
+
+// Arrays smaller than this are sorted on the calling thread only
+#define PARALLEL_SORT_MIN_LENGTH (1 << 16)
+#define PARALLEL_SORT_MAX_THREADS 64
+
+/**
+ * A parallel merge-sort by duration.
+ *
+ * The array is split into one run per thread, and every run is sorted by
+ * its own thread. The runs are then merged in pairs, round after round, and
+ * each merge is itself split between the threads of its round - every thread
+ * finds the part of both runs that lands in its slice of the output with a
+ * binary search, so the last merges use all threads just like the first.
+ * Arrays shorter than PARALLEL_SORT_MIN_LENGTH are sorted sequentially.
+ *
+ * @param start the start of the array to sort
+ * @param end the end of the array to sort
+ * @param threads number of threads to sort with
+ * @return 1 if the array was sorted, 0 if memory allocation failed (and the
+ *         array is unchanged)
+ */
+int parallel_sort (BusLine *start, BusLine *end, int threads);
+
+/**
+ * A stable variant of parallel_sort - lines with the same duration keep
+ * their original order.
+ *
+ * @param start the start of the array to sort
+ * @param end the end of the array to sort
+ * @param threads number of threads to sort with
+ * @return 1 if the array was sorted, 0 if memory allocation failed (and the
+ *         array is unchanged)
+ */
+int parallel_stable_sort (BusLine *start, BusLine *end, int threads);
+
+/**
+ * Returns the number of processors online, to use as a number of threads.
+ */
+int get_processor_count (void);
+
+#endif // EX2_REPO_PARALLELSORTBUSLINES_H
@@ -0,0 +1,317 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "key_sort_bus_lines.h"
+#include "route_index_bus_lines.h"
+
+// Range of a tree node with no lines under it, which no query finds
+#define EMPTY_DURATION INT_MAX
+
+static int reserve_tree (RouteIndex *index, int length);
+static void build_tree (RouteIndex *index);
+static void build_prefix_counts (RouteIndex *index);
+static int report_lines (const RouteIndex *index, int node, int node_start,
+                         int node_end, int start, int end, int max_duration,
+                         BusLine *output, int capacity, int found);
+static int lower_bound (const RouteIndex *index, int distance);
+static int sort_by_distance (BusLine *start, BusLine *end);
+
+int create_route_index (BusLine *start, BusLine *end, RouteIndex *index)
+{
+  *index = (RouteIndex) { NULL, 0, 0, NULL, 0, NULL };
+
+  index->prefix_counts = malloc (sizeof (int) * ROUTE_DISTANCE_ROWS
+                                 * ROUTE_DURATION_COLUMNS);
+  if (index->prefix_counts == NULL
+      || !insert_into_route_index (index, start, end))
+  {
+    free_route_index (index);
+    return 0;
+  }
+
+  return 1;
+}
+
+int insert_into_route_index (RouteIndex *index, const BusLine *start,
+                             const BusLine *end)
+{
+  int count = get_number_of_elements ((BusLine *) start, (BusLine *) end);
+  int length = index->length + count;
+
+  BusLine *batch = malloc (sizeof (BusLine) * (count > 0 ? count : 1));
+  if (batch == NULL)
+  {
+    return 0;
+  }
+  memcpy (batch, start, sizeof (BusLine) * count);
+
+  if (!sort_by_distance (batch, batch + count))
+  {
+    free (batch);
+    return 0;
+  }
+
+  if (length > index->capacity)
+  {
+    int capacity = index->capacity * 2 > length ? index->capacity * 2 : length;
+    BusLine *lines = realloc (index->lines, sizeof (BusLine) * capacity);
+    if (lines == NULL)
+    {
+      free (batch);
+      return 0;
+    }
+
+    index->lines = lines;
+    index->capacity = capacity;
+  }
+
+  if (!reserve_tree (index, length))
+  {
+    free (batch);
+    return 0;
+  }
+
+  // Merging from the back, in place. Lines of the batch go after indexed
+  // lines of the same distance, so the index stays stable.
+  BusLine *lines = index->lines;
+  int i = index->length - 1, j = count - 1;
+  for (int output = length - 1; j >= 0; output--)
+  {
+    if (i >= 0 && lines[i].distance > batch[j].distance)
+    {
+      lines[output] = lines[i--];
+    }
+    else
+    {
+      lines[output] = batch[j--];
+    }
+  }
+  COUNT_COMPARISONS (count);
+
+  free (batch);
+
+  index->length = length;
+  build_tree (index);
+  build_prefix_counts (index);
+
+  return 1;
+}
+
+int query_route_index (const RouteIndex *index, int min_distance,
+                       int max_distance, int max_duration, BusLine *output,
+                       int capacity)
+{
+  if (min_distance > max_distance || index->length == 0)
+  {
+    return 0;
+  }
+
+  int start = lower_bound (index, min_distance);
+  int end = max_distance == INT_MAX ? index->length
+                                    : lower_bound (index, max_distance + 1);
+
+  return report_lines (index, 1, 0, index->leaf_count, start, end,
+                       max_duration, output, output == NULL ? 0 : capacity, 0);
+}
+
+int count_route_index (const RouteIndex *index, int min_distance,
+                       int max_distance, int max_duration)
+{
+  min_distance = min_distance < MIN_DISTANCE ? MIN_DISTANCE : min_distance;
+  max_distance = max_distance > MAX_DISTANCE ? MAX_DISTANCE : max_distance;
+  max_duration = max_duration > MAX_DURATION ? MAX_DURATION : max_duration;
+
+  if (min_distance > max_distance || max_duration < MIN_DURATION)
+  {
+    return 0;
+  }
+
+  const int *counts = index->prefix_counts;
+  int column = max_duration - MIN_DURATION + 1;
+  int high_row = max_distance - MIN_DISTANCE + 1;
+  int low_row = min_distance - MIN_DISTANCE;
+
+  return counts[(high_row * ROUTE_DURATION_COLUMNS) + column]
+         - counts[(low_row * ROUTE_DURATION_COLUMNS) + column];
+}
+
+void free_route_index (RouteIndex *index)
+{
+  free (index->lines);
+  free (index->tree);
+  free (index->prefix_counts);
+
+  *index = (RouteIndex) { NULL, 0, 0, NULL, 0, NULL };
+}
+
+/**
+ * Makes room in the segment tree for the given number of lines. The tree is
+ * only replaced once the new one is allocated.
+ */
+static int reserve_tree (RouteIndex *index, int length)
+{
+  int leaf_count = 1;
+  while (leaf_count < length)
+  {
+    leaf_count *= 2;
+  }
+
+  if (leaf_count == index->leaf_count && index->tree != NULL)
+  {
+    return 1;
+  }
+
+  DurationRange *tree = malloc (sizeof (DurationRange) * 2 * leaf_count);
+  if (tree == NULL)
+  {
+    return 0;
+  }
+
+  free (index->tree);
+  index->tree = tree;
+  index->leaf_count = leaf_count;
+
+  return 1;
+}
+
+/**
+ * Rebuilds the segment tree over the indexed lines, bottom up, in O(N).
+ * Node i has its children at 2i and 2i+1, and the tree's root is node 1.
+ */
+static void build_tree (RouteIndex *index)
+{
+  DurationRange *tree = index->tree;
+  int leaf_count = index->leaf_count;
+
+  for (int i = 0; i < leaf_count; i++)
+  {
+    int duration = i < index->length ? index->lines[i].duration
+                                     : EMPTY_DURATION;
+    tree[leaf_count + i] = (DurationRange) { duration, duration };
+  }
+
+  for (int node = leaf_count - 1; node > 0; node--)
+  {
+    DurationRange left = tree[2 * node], right = tree[(2 * node) + 1];
+    tree[node].min = left.min < right.min ? left.min : right.min;
+    tree[node].max = left.max > right.max ? left.max : right.max;
+  }
+}
+
+/**
+ * Rebuilds the grid of prefix counts, in O(N) - counts the lines of every
+ * cell, then sums the cells along the durations and then along the
+ * distances. Cell (i, j) ends up counting the lines with a distance below
+ * the i-th and a duration below the j-th.
+ */
+static void build_prefix_counts (RouteIndex *index)
+{
+  int *counts = index->prefix_counts;
+  memset (counts, 0,
+          sizeof (int) * ROUTE_DISTANCE_ROWS * ROUTE_DURATION_COLUMNS);
+
+  for (int i = 0; i < index->length; i++)
+  {
+    const BusLine *line = index->lines + i;
+
+    // Comparing as unsigned checks both ends of a range at once.
+    if ((unsigned int) line->distance - MIN_DISTANCE
+            <= (unsigned int) (MAX_DISTANCE - MIN_DISTANCE)
+        && (unsigned int) line->duration - MIN_DURATION
+               <= (unsigned int) (MAX_DURATION - MIN_DURATION))
+    {
+      int row = line->distance - MIN_DISTANCE + 1;
+      int column = line->duration - MIN_DURATION + 1;
+      counts[(row * ROUTE_DURATION_COLUMNS) + column]++;
+    }
+  }
+
+  for (int row = 1; row < ROUTE_DISTANCE_ROWS; row++)
+  {
+    int *cells = counts + (row * ROUTE_DURATION_COLUMNS);
+    const int *previous = cells - ROUTE_DURATION_COLUMNS;
+
+    for (int column = 1; column < ROUTE_DURATION_COLUMNS; column++)
+    {
+      cells[column] += cells[column - 1];
+    }
+    for (int column = 1; column < ROUTE_DURATION_COLUMNS; column++)
+    {
+      cells[column] += previous[column];
+    }
+  }
+}
+
+/**
+ * Reports the lines under the given node which are between start and end
+ * and fast enough, from left to right. Nodes outside of the range, or with
+ * no fast enough line under them, are skipped whole.
+ *
+ * @return the number of lines found so far, including the given ones
+ */
+static int report_lines (const RouteIndex *index, int node, int node_start,
+                         int node_end, int start, int end, int max_duration,
+                         BusLine *output, int capacity, int found)
+{
+  if (node_end <= start || end <= node_start
+      || index->tree[node].min > max_duration || node_start >= index->length)
+  {
+    return found;
+  }
+
+  // All lines of a node inside the range are found, if the slowest is - which
+  // always holds for a single line that wasn't skipped.
+  if (start <= node_start && node_end <= end && node_end <= index->length
+      && index->tree[node].max <= max_duration)
+  {
+    int count = node_end - node_start;
+    if (found < capacity)
+    {
+      int copied = capacity - found < count ? capacity - found : count;
+      memcpy (output + found, index->lines + node_start,
+              sizeof (BusLine) * copied);
+    }
+    return found + count;
+  }
+
+  int middle = node_start + ((node_end - node_start) / 2);
+  found = report_lines (index, 2 * node, node_start, middle, start, end,
+                        max_duration, output, capacity, found);
+
+  return report_lines (index, (2 * node) + 1, middle, node_end, start, end,
+                       max_duration, output, capacity, found);
+}
+
+/**
+ * Returns the index of the first line whose distance is at least the given
+ * one, or the length if there's none.
+ */
+static int lower_bound (const RouteIndex *index, int distance)
+{
+  int low = 0, high = index->length;
+  while (low < high)
+  {
+    int middle = low + ((high - low) / 2);
+    if (index->lines[middle].distance < distance)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  return low;
+}
+
+/**
+ * Sorts the given lines by distance, stably.
+ */
+static int sort_by_distance (BusLine *start, BusLine *end)
+{
+  SortSpec spec = { { SORT_BY_DISTANCE }, { 0 }, 1 };
+
+  return key_sort (start, end, &spec);
+}
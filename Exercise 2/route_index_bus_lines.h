@@ -0,0 +1,104 @@
+#ifndef EX2_REPO_ROUTEINDEXBUSLINES_H
+#define EX2_REPO_ROUTEINDEXBUSLINES_H
+
+#include "sort_bus_lines.h"
+
+/**
+ * A persistent index over bus lines, answering "which lines have a distance
+ * in [a, b] and a duration of at most d" without sorting them again.
+ *
+ * The bus lines are kept sorted by distance, so the lines of a distance
+ * range are a contiguous slice found by binary search. Over them sits a
+ * segment tree holding the smallest and largest duration under every node,
+ * so a query skips nodes with no fast enough line, and takes nodes whose
+ * lines are all fast enough whole. A query finding K lines takes
+ * O(log(N) + K*log(N)) at worst, and O(log(N) + K) when the fast enough
+ * lines are clustered.
+ *
+ * Since both fields span small ranges, the index also keeps a grid of
+ * prefix counts over (distance, duration), which counts the lines of any
+ * query in O(1) without finding them.
+ */
+typedef struct DurationRange
+{
+  int min, max;
+} DurationRange;
+
+typedef struct RouteIndex
+{
+  BusLine *lines; // Sorted by distance, stably
+  int length, capacity;
+  DurationRange *tree; // The segment tree, with its leaves from leaf_count on
+  int leaf_count; // A power of 2, at least the length
+  int *prefix_counts; // Lines with a smaller distance and duration than cell
+} RouteIndex;
+
+// Rows and columns of the prefix counts grid - one more than the range of
+// each field, for the empty prefix
+#define ROUTE_DISTANCE_ROWS (MAX_DISTANCE - MIN_DISTANCE + 2)
+#define ROUTE_DURATION_COLUMNS (MAX_DURATION - MIN_DURATION + 2)
+
+/**
+ * Builds an index over the given bus lines, copying them, with dynamic
+ * memory using malloc. The index must be released with free_route_index.
+ *
+ * @param start the start of the array to index
+ * @param end the end of the array to index
+ * @param index the index to build
+ * @return 1 if the index was built, 0 if memory allocation failed
+ */
+int create_route_index (BusLine *start, BusLine *end, RouteIndex *index);
+
+/**
+ * Adds a batch of bus lines to the index. The batch is sorted by distance
+ * and merged into the indexed lines, and the segment tree is rebuilt once,
+ * so inserting M lines takes O(N + M*log(M)) - inserting in large batches
+ * is much cheaper than one line at a time.
+ *
+ * @param index the index to add to
+ * @param start the start of the batch, which is left unchanged
+ * @param end the end of the batch
+ * @return 1 if the batch was added, 0 if memory allocation failed (and the
+ *         index is unchanged)
+ */
+int insert_into_route_index (RouteIndex *index, const BusLine *start,
+                             const BusLine *end);
+
+/**
+ * Finds the bus lines with a distance between min_distance and max_distance
+ * (includes), and a duration of at most max_duration. A dominance query -
+ * lines no farther and no slower than given - is a query from MIN_DISTANCE.
+ *
+ * @param index the index to query
+ * @param min_distance smallest distance to find
+ * @param max_distance largest distance to find
+ * @param max_duration largest duration to find
+ * @param output array to copy the found lines into, by distance, may be NULL
+ * @param capacity most lines to copy into the output
+ * @return the number of lines found, which may be more than the capacity
+ */
+int query_route_index (const RouteIndex *index, int min_distance,
+                       int max_distance, int max_duration, BusLine *output,
+                       int capacity);
+
+/**
+ * Counts the bus lines a query would find, in O(1). Only lines in the valid
+ * ranges of both fields are counted, as is every line the loaders keep.
+ *
+ * @param index the index to query
+ * @param min_distance smallest distance to count
+ * @param max_distance largest distance to count
+ * @param max_duration largest duration to count
+ * @return the number of lines found
+ */
+int count_route_index (const RouteIndex *index, int min_distance,
+                       int max_distance, int max_duration);
+
+/**
+ * Releases the memory of the given index.
+ *
+ * @param index the index to release
+ */
+void free_route_index (RouteIndex *index);
+
+#endif // EX2_REPO_ROUTEINDEXBUSLINES_H
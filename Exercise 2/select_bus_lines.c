@@ -0,0 +1,48 @@
+#include "select_bus_lines.h"
+
+void nth_element (BusLine *start, BusLine *nth, BusLine *end, SortKey key)
+{
+  int depth_limit = 0;
+  for (int n = get_number_of_elements (start, end); n > 1; n >>= 1)
+  {
+    depth_limit += 2;
+  }
+
+  while (get_number_of_elements (start, end) > INSERTION_SORT_THRESHOLD)
+  {
+    if (depth_limit == 0)
+    {
+      heap_sort_by_key (start, end, key);
+      return;
+    }
+    depth_limit--;
+
+    BusLine *mid = partition_median_by_key (start, end, key);
+    if (mid == nth)
+    {
+      return;
+    }
+
+    // Following only the side nth is in.
+    if (nth < mid)
+    {
+      end = mid;
+    }
+    else
+    {
+      start = mid + 1;
+    }
+  }
+
+  insertion_sort_by_key (start, end, key);
+}
+
+void top_k (BusLine *start, BusLine *end, int k, SortKey key)
+{
+  if (k < get_number_of_elements (start, end))
+  {
+    nth_element (start, start + k, end, key);
+  }
+
+  heap_sort_by_key (start, start + k, key);
+}
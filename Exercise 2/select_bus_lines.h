@@ -0,0 +1,36 @@
+#ifndef EX2_REPO_SELECTBUSLINES_H
+#define EX2_REPO_SELECTBUSLINES_H
+
+#include "sort_bus_lines.h"
+
+/**
+ * An implementation of the Introselect algorithm - rearranges the array so
+ * nth holds the bus line that would be there if the array was sorted by the
+ * given key, every bus line before it is not larger, and every one after it
+ * is not smaller.
+ *
+ * It's a quick-select with median-of-three pivots, which only follows the
+ * side nth is in, so it's O(N) on average. Once the partitions get too
+ * unbalanced it heap-sorts the remaining range, so it's never worse than
+ * O(N*log(N)).
+ *
+ * @param start the start of the array
+ * @param nth the position to select, between start and end
+ * @param end the end of the array
+ * @param key the field to select by
+ */
+void nth_element (BusLine *start, BusLine *nth, BusLine *end, SortKey key);
+
+/**
+ * Moves the ${k} smallest bus lines by the given key to the start of the
+ * array, sorted, in O(N + K*log(K)). The rest of the array is left in no
+ * particular order.
+ *
+ * @param start the start of the array
+ * @param end the end of the array
+ * @param k number of bus lines to select, at most the array's length
+ * @param key the field to select by
+ */
+void top_k (BusLine *start, BusLine *end, int k, SortKey key);
+
+#endif // EX2_REPO_SELECTBUSLINES_H
@@ -0,0 +1,170 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "key_sort_bus_lines.h"
+#include "soa_bus_lines.h"
+
+#define INDEX_BITS 32
+
+static int counting_sort_index (const int *column, int length, int min,
+                                int max, int *index);
+static int packed_sort_index (const int *column, int length, int min,
+                              int *index);
+
+int create_columns (BusLine *start, BusLine *end, BusLineColumns *columns)
+{
+  int length = get_number_of_elements (start, end);
+
+  // Allocating at least one element, so an empty array isn't a failure.
+  size_t size = sizeof (int) * (length > 0 ? length : 1);
+  columns->line_numbers = malloc (size);
+  columns->distances = malloc (size);
+  columns->durations = malloc (size);
+  columns->length = length;
+
+  if (columns->line_numbers == NULL || columns->distances == NULL
+      || columns->durations == NULL)
+  {
+    free_columns (columns);
+    return 0;
+  }
+
+  for (int i = 0; i < length; i++)
+  {
+    columns->line_numbers[i] = start[i].line_number;
+    columns->distances[i] = start[i].distance;
+    columns->durations[i] = start[i].duration;
+  }
+
+  return 1;
+}
+
+void free_columns (BusLineColumns *columns)
+{
+  free (columns->line_numbers);
+  free (columns->distances);
+  free (columns->durations);
+
+  columns->line_numbers = NULL;
+  columns->distances = NULL;
+  columns->durations = NULL;
+  columns->length = 0;
+}
+
+const int *get_column (const BusLineColumns *columns, SortKey key)
+{
+  switch (key)
+  {
+  case SORT_BY_LINE_NUMBER:
+    return columns->line_numbers;
+  case SORT_BY_DISTANCE:
+    return columns->distances;
+  default:
+    return columns->durations;
+  }
+}
+
+int sort_index (const BusLineColumns *columns, SortKey key, int *index)
+{
+  const int *column = get_column (columns, key);
+  int length = columns->length;
+  if (length == 0)
+  {
+    return 1;
+  }
+
+  int min = column[0], max = column[0];
+  for (int i = 1; i < length; i++)
+  {
+    min = column[i] < min ? column[i] : min;
+    max = column[i] > max ? column[i] : max;
+  }
+
+  if ((long long) max - min < (long long) length)
+  {
+    return counting_sort_index (column, length, min, max, index);
+  }
+
+  return packed_sort_index (column, length, min, index);
+}
+
+void gather_bus_lines (const BusLineColumns *columns, const int *index,
+                       BusLine *output)
+{
+  for (int i = 0; i < columns->length; i++)
+  {
+    int from = index[i];
+    output[i].line_number = columns->line_numbers[from];
+    output[i].distance = columns->distances[from];
+    output[i].duration = columns->durations[from];
+  }
+}
+
+/**
+ * Counting-sorts the indexes by a column whose values span [min, max].
+ *
+ * @return 1 if the index was filled, 0 if memory allocation failed
+ */
+static int counting_sort_index (const int *column, int length, int min,
+                                int max, int *index)
+{
+  size_t range = (size_t) ((long long) max - min) + 1;
+  int *positions = calloc (range, sizeof (int));
+  if (positions == NULL)
+  {
+    return 0;
+  }
+
+  for (int i = 0; i < length; i++)
+  {
+    positions[column[i] - min]++;
+  }
+
+  int position = 0;
+  for (size_t i = 0; i < range; i++)
+  {
+    int count = positions[i];
+    positions[i] = position;
+    position += count;
+  }
+
+  for (int i = 0; i < length; i++)
+  {
+    index[positions[column[i] - min]++] = i;
+  }
+
+  free (positions);
+  return 1;
+}
+
+/**
+ * Sorts the indexes by a column of any range, through packed keys holding
+ * the value in their high half and the index in their low half.
+ *
+ * @return 1 if the index was filled, 0 if memory allocation failed
+ */
+static int packed_sort_index (const int *column, int length, int min,
+                              int *index)
+{
+  uint64_t *keys = malloc (sizeof (uint64_t) * length);
+  if (keys == NULL)
+  {
+    return 0;
+  }
+
+  for (int i = 0; i < length; i++)
+  {
+    uint64_t value = (uint64_t) ((long long) column[i] - min);
+    keys[i] = (value << INDEX_BITS) | (uint64_t) i;
+  }
+
+  sort_packed_keys (keys, keys + length);
+
+  for (int i = 0; i < length; i++)
+  {
+    index[i] = (int) (keys[i] & UINT32_MAX);
+  }
+
+  free (keys);
+  return 1;
+}
@@ -0,0 +1,71 @@
+#ifndef EX2_REPO_SOABUSLINES_H
+#define EX2_REPO_SOABUSLINES_H
+
+#include "sort_bus_lines.h"
+
+/**
+ * Bus lines stored as a structure of arrays - a separate column for every
+ * field. Sorting reads only the column it sorts by, and an ordering is an
+ * array of indexes into the columns, so several orderings can coexist
+ * without copying any bus line.
+ */
+typedef struct BusLineColumns
+{
+  int *line_numbers, *distances, *durations;
+  int length;
+} BusLineColumns;
+
+/**
+ * Splits the given bus lines into columns, with dynamic memory using malloc.
+ * The columns must be released with free_columns.
+ *
+ * @param start the start of the array to split
+ * @param end the end of the array to split
+ * @param columns the columns to fill
+ * @return 1 if the columns were created, 0 if memory allocation failed
+ */
+int create_columns (BusLine *start, BusLine *end, BusLineColumns *columns);
+
+/**
+ * Releases the memory of the given columns.
+ *
+ * @param columns the columns to release
+ */
+void free_columns (BusLineColumns *columns);
+
+/**
+ * Returns the column of the given key.
+ *
+ * @param columns the columns to look in
+ * @param key the field of the column
+ */
+const int *get_column (const BusLineColumns *columns, SortKey key);
+
+/**
+ * Fills the index array with the order of the bus lines by the given key,
+ * stably - index[0] is the index of the first bus line, and so on.
+ *
+ * A small range of keys is counting-sorted, reading the column once in order
+ * and writing each index straight to its place. Otherwise every key is packed
+ * with its index into a single 64-bit integer, and those are sorted.
+ * Either way, no bus line is moved.
+ *
+ * @param columns the columns to sort
+ * @param key the field to sort by
+ * @param index array of ${columns->length} indexes to fill
+ * @return 1 if the index was filled, 0 if memory allocation failed
+ */
+int sort_index (const BusLineColumns *columns, SortKey key, int *index);
+
+/**
+ * Gathers the bus lines into an array in the order of the given index - the
+ * only step that touches whole bus lines.
+ *
+ * @param columns the columns to gather from
+ * @param index the order of the bus lines
+ * @param output array of ${columns->length} bus lines to fill
+ */
+void gather_bus_lines (const BusLineColumns *columns, const int *index,
+                       BusLine *output);
+
+#endif // EX2_REPO_SOABUSLINES_H
@@ -1,13 +1,31 @@
+#include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "sort_bus_lines.h"
 
+SORT_THREAD_LOCAL SortCounters sort_counters = { 0, 0 };
+
 void bubble_sort (BusLine *start, BusLine *end)
+{
+  // Counting-sort is stable as well, so the result is the same
+  if (should_counting_sort (start, end, SORT_BY_DISTANCE)
+      && counting_sort (start, end, SORT_BY_DISTANCE))
+  {
+    return;
+  }
+
+  bubble_sort_loop (start, end);
+}
+
+void bubble_sort_loop (BusLine *start, BusLine *end)
 {
   int length = get_number_of_elements (start, end);
 
   for (int i = 0; i < length; i++)
   {
+    COUNT_COMPARISONS (length - i - 1);
     for (int j = 0; j < (length - i - 1); j++)
     {
       if ((*(start + j)).distance > (*(start + j + 1)).distance)
@@ -20,11 +38,478 @@ void bubble_sort (BusLine *start, BusLine *end)
 
 void quick_sort (BusLine *start, BusLine *end)
 {
-  if (start < end)
+  if (should_counting_sort (start, end, SORT_BY_DURATION)
+      && counting_sort (start, end, SORT_BY_DURATION))
+  {
+    return;
+  }
+
+  introsort (start, end);
+}
+
+void introsort (BusLine *start, BusLine *end)
+{
+  int length = get_number_of_elements (start, end);
+
+  // Allowing twice the depth of a perfectly balanced recursion before giving
+  // up on the pivots and switching to heap-sort.
+  int depth_limit = 0;
+  for (int n = length; n > 1; n >>= 1)
+  {
+    depth_limit += 2;
+  }
+
+  introsort_loop (start, end, depth_limit);
+  insertion_sort (start, end);
+}
+
+void introsort_loop (BusLine *start, BusLine *end, int depth_limit)
+{
+  // Ranges smaller than the cutoff are left unsorted, and sorted all at once
+  // by a single insertion-sort pass over the whole array.
+  while (get_number_of_elements (start, end) > INSERTION_SORT_THRESHOLD)
+  {
+    if (depth_limit == 0)
+    {
+      heap_sort (start, end);
+      return;
+    }
+    depth_limit--;
+
+    BusLine *mid = block_partition (start, end);
+
+    // Recursing into the smaller side and looping over the larger one, so the
+    // stack never grows beyond log(N) frames.
+    if (mid - start < end - (mid + 1))
+    {
+      introsort_loop (start, mid, depth_limit);
+      start = mid + 1;
+    }
+    else
+    {
+      introsort_loop (mid + 1, end, depth_limit);
+      end = mid;
+    }
+  }
+}
+
+BusLine *partition_median (BusLine *start, BusLine *end)
+{
+  return partition_median_by_key (start, end, SORT_BY_DURATION);
+}
+
+BusLine *partition_median_by_key (BusLine *start, BusLine *end, SortKey key)
+{
+  size_t offset = get_key_offset (key);
+
+  select_pivot_by_key (start, end, offset);
+  int pivot = get_key_value (start, offset);
+
+  /*
+    Hoare partitioning around the pivot at start.
+    Both scans stop at elements equal to the pivot and swap them, so a range
+    of equal durations is split in half rather than peeled one at a time.
+  */
+  BusLine *i = start;
+  BusLine *j = end;
+  while (1)
+  {
+    do
+    {
+      i++;
+    } while (i < end && get_key_value (i, offset) < pivot);
+
+    do
+    {
+      j--;
+    } while (get_key_value (j, offset) > pivot);
+
+    if (i >= j)
+    {
+      break;
+    }
+
+    swap (i, j);
+  }
+
+  // Every step of both scans compared a single element.
+  COUNT_COMPARISONS ((i - start) + (end - j));
+  swap (start, j);
+
+  return j;
+}
+
+BusLine *block_partition (BusLine *start, BusLine *end)
+{
+  select_pivot (start, end);
+  int pivot = (*start).duration;
+
+  // Offsets of the elements in the current left block that belong on the
+  // right, and of those in the current right block that belong on the left
+  // (counted from the end, starting at 1).
+  unsigned char left_offsets[PARTITION_BLOCK_SIZE];
+  unsigned char right_offsets[PARTITION_BLOCK_SIZE];
+  int left_count = 0, right_count = 0, left_start = 0, right_start = 0;
+
+  BusLine *first = start + 1;
+  BusLine *last = end;
+  unsigned long long comparisons = 0;
+
+  /*
+    Both scans stop at elements equal to the pivot, just like in Hoare
+    partitioning, so a range of equal durations is split in half.
+    While there's room for two whole blocks, both sides take full blocks.
+    Then the unknown elements between them are split into a last pair of
+    blocks, one of which may still be pending from before.
+  */
+  while (1)
+  {
+    int unknown = (int) (last - first);
+    int left_size = PARTITION_BLOCK_SIZE, right_size = PARTITION_BLOCK_SIZE;
+    int is_last_round = unknown <= 2 * PARTITION_BLOCK_SIZE;
+
+    if (is_last_round)
+    {
+      int pending = left_count > 0 || right_count > 0 ? PARTITION_BLOCK_SIZE
+                                                      : 0;
+      unknown -= pending;
+
+      if (right_count > 0)
+      {
+        left_size = unknown;
+      }
+      else if (left_count > 0)
+      {
+        right_size = unknown;
+      }
+      else
+      {
+        left_size = unknown / 2;
+        right_size = unknown - left_size;
+      }
+    }
+
+    // Every element's offset is written, and the count only grows if it
+    // belongs on the other side - there's no branch on the comparison.
+    if (left_count == 0)
+    {
+      left_start = 0;
+      for (int i = 0; i < left_size; i++)
+      {
+        left_offsets[left_count] = (unsigned char) i;
+        left_count += first[i].duration >= pivot;
+      }
+      comparisons += left_size;
+    }
+
+    if (right_count == 0)
+    {
+      right_start = 0;
+      for (int i = 1; i <= right_size; i++)
+      {
+        right_offsets[right_count] = (unsigned char) i;
+        right_count += last[-i].duration <= pivot;
+      }
+      comparisons += right_size;
+    }
+
+    int count = left_count < right_count ? left_count : right_count;
+    for (int i = 0; i < count; i++)
+    {
+      swap (first + left_offsets[left_start + i],
+            last - right_offsets[right_start + i]);
+    }
+
+    left_count -= count;
+    right_count -= count;
+    left_start += count;
+    right_start += count;
+
+    // A block is done once all of its misplaced elements were swapped away
+    if (left_count == 0)
+    {
+      first += left_size;
+    }
+    if (right_count == 0)
+    {
+      last -= right_size;
+    }
+
+    if (is_last_round)
+    {
+      break;
+    }
+  }
+
+  /*
+    The scans met. What's left is a single block whose misplaced elements
+    weren't swapped yet - moving them to the block's far end, from the
+    farthest one in.
+  */
+  if (left_count > 0)
+  {
+    while (left_count > 0)
+    {
+      left_count--;
+      swap (first + left_offsets[left_start + left_count], --last);
+    }
+    first = last;
+  }
+
+  if (right_count > 0)
+  {
+    while (right_count > 0)
+    {
+      right_count--;
+      swap (last - right_offsets[right_start + right_count], first++);
+    }
+  }
+
+  COUNT_COMPARISONS (comparisons);
+
+  // Everything before first is not larger than the pivot, and everything
+  // from it on is not smaller.
+  swap (start, first - 1);
+
+  return first - 1;
+}
+
+void select_pivot (BusLine *start, BusLine *end)
+{
+  select_pivot_by_key (start, end, get_key_offset (SORT_BY_DURATION));
+}
+
+void select_pivot_by_key (BusLine *start, BusLine *end, size_t offset)
+{
+  int length = get_number_of_elements (start, end);
+  BusLine *last = end - 1;
+  BusLine *middle = start + (length / 2);
+
+  // Large ranges take the median of three medians, so sorted, reversed and
+  // sawtooth inputs still split close to the middle.
+  if (length > NINTHER_THRESHOLD)
+  {
+    int step = length / 8;
+    median_of_three_by_key (start, start + step, start + 2 * step, offset);
+    median_of_three_by_key (middle - step, middle, middle + step, offset);
+    median_of_three_by_key (last - 2 * step, last - step, last, offset);
+    median_of_three_by_key (start + step, middle, last - step, offset);
+  }
+  else
+  {
+    median_of_three_by_key (start, middle, last, offset);
+  }
+
+  swap (start, middle);
+}
+
+void median_of_three (BusLine *a, BusLine *b, BusLine *c)
+{
+  median_of_three_by_key (a, b, c, get_key_offset (SORT_BY_DURATION));
+}
+
+void median_of_three_by_key (BusLine *a, BusLine *b, BusLine *c,
+                             size_t offset)
+{
+  if (get_key_value (b, offset) < get_key_value (a, offset))
+  {
+    swap (a, b);
+  }
+  COUNT_COMPARISONS (2);
+  if (get_key_value (c, offset) < get_key_value (b, offset))
+  {
+    swap (b, c);
+    COUNT_COMPARISONS (1);
+    if (get_key_value (b, offset) < get_key_value (a, offset))
+    {
+      swap (a, b);
+    }
+  }
+}
+
+void heap_sort (BusLine *start, BusLine *end)
+{
+  heap_sort_by_key (start, end, SORT_BY_DURATION);
+}
+
+void heap_sort_by_key (BusLine *start, BusLine *end, SortKey key)
+{
+  size_t offset = get_key_offset (key);
+  int length = get_number_of_elements (start, end);
+
+  for (int i = (length / 2) - 1; i >= 0; i--)
+  {
+    sift_down_by_key (start, i, length, offset);
+  }
+
+  for (int i = length - 1; i > 0; i--)
+  {
+    swap (start, start + i);
+    sift_down_by_key (start, 0, i, offset);
+  }
+}
+
+void sift_down (BusLine *start, int root, int length)
+{
+  sift_down_by_key (start, root, length, get_key_offset (SORT_BY_DURATION));
+}
+
+void sift_down_by_key (BusLine *start, int root, int length, size_t offset)
+{
+  BusLine value = *(start + root);
+  int key = get_key_value (&value, offset);
+
+  // Moving the hole down rather than swapping at every level.
+  unsigned long long comparisons = 0;
+  int child = (2 * root) + 1;
+  while (child < length)
+  {
+    comparisons += 1 + (child + 1 < length);
+    if (child + 1 < length
+        && get_key_value (start + child, offset)
+               < get_key_value (start + child + 1, offset))
+    {
+      child++;
+    }
+
+    if (get_key_value (start + child, offset) <= key)
+    {
+      break;
+    }
+
+    *(start + root) = *(start + child);
+    root = child;
+    child = (2 * root) + 1;
+  }
+
+  *(start + root) = value;
+  COUNT_COMPARISONS (comparisons);
+}
+
+void insertion_sort (BusLine *start, BusLine *end)
+{
+  insertion_sort_by_key (start, end, SORT_BY_DURATION);
+}
+
+void insertion_sort_by_key (BusLine *start, BusLine *end, SortKey key)
+{
+  size_t offset = get_key_offset (key);
+
+  for (BusLine *current = start + 1; current < end; current++)
+  {
+    BusLine value = *current;
+    int value_key = get_key_value (current, offset);
+
+    BusLine *hole = current;
+    while (hole > start && get_key_value (hole - 1, offset) > value_key)
+    {
+      *hole = *(hole - 1);
+      hole--;
+    }
+
+    // A comparison per move, and one that stopped it unless it hit start
+    COUNT_COMPARISONS ((current - hole) + (hole > start));
+    *hole = value;
+  }
+}
+
+int should_counting_sort (BusLine *start, BusLine *end, SortKey key)
+{
+  int length = get_number_of_elements (start, end);
+  if (length < COUNTING_SORT_MIN_LENGTH)
+  {
+    return 0;
+  }
+
+  int min, max;
+  get_key_range (start, end, key, &min, &max);
+
+  // Comparing in long long, since max - min may overflow an int.
+  return (long long) max - min < (long long) length;
+}
+
+int counting_sort (BusLine *start, BusLine *end, SortKey key)
+{
+  int length = get_number_of_elements (start, end);
+  if (length < 2)
+  {
+    return 1;
+  }
+
+  int min, max;
+  get_key_range (start, end, key, &min, &max);
+
+  size_t range = (size_t) ((long long) max - min) + 1;
+  size_t *positions = calloc (range, sizeof (size_t));
+  BusLine *sorted = malloc (sizeof (BusLine) * length);
+  if (positions == NULL || sorted == NULL)
+  {
+    free (positions);
+    free (sorted);
+    return 0;
+  }
+
+  size_t offset = get_key_offset (key);
+
+  for (BusLine *current = start; current < end; current++)
+  {
+    positions[get_key_value (current, offset) - min]++;
+  }
+
+  // Turning the counts into the position of each key's first element.
+  size_t position = 0;
+  for (size_t i = 0; i < range; i++)
+  {
+    size_t count = positions[i];
+    positions[i] = position;
+    position += count;
+  }
+
+  // A single scatter pass, in order, which keeps equal keys stable.
+  for (BusLine *current = start; current < end; current++)
+  {
+    int value = get_key_value (current, offset);
+    sorted[positions[value - min]++] = *current;
+  }
+
+  memcpy (start, sorted, sizeof (BusLine) * length);
+
+  free (positions);
+  free (sorted);
+  return 1;
+}
+
+void get_key_range (BusLine *start, BusLine *end, SortKey key, int *min,
+                    int *max)
+{
+  size_t offset = get_key_offset (key);
+
+  *min = 0;
+  *max = 0;
+  for (BusLine *current = start; current < end; current++)
+  {
+    int value = get_key_value (current, offset);
+    if (current == start || value < *min)
+    {
+      *min = value;
+    }
+    if (current == start || value > *max)
+    {
+      *max = value;
+    }
+  }
+}
+
+size_t get_key_offset (SortKey key)
+{
+  switch (key)
   {
-    BusLine *mid = partition (start, end);
-    quick_sort (start, mid);
-    quick_sort (mid + 1, end);
+  case SORT_BY_LINE_NUMBER:
+    return offsetof (BusLine, line_number);
+  case SORT_BY_DISTANCE:
+    return offsetof (BusLine, distance);
+  default:
+    return offsetof (BusLine, duration);
   }
 }
 
@@ -43,6 +528,7 @@ BusLine *partition (BusLine *start, BusLine *end)
     we know the current element (j) is smaller than pivot, and element i is
     larger than pivot because we've just increased it.
   */
+  COUNT_COMPARISONS (length - 1);
   for (int j = 0; j < length - 1; j++)
   {
     if ((*(start + j)).duration <= (*(start + pivot)).duration)
@@ -59,6 +545,7 @@ BusLine *partition (BusLine *start, BusLine *end)
 
 void swap (BusLine *a, BusLine *b)
 {
+  COUNT_SWAPS (1);
   BusLine temp = *a;
   *a = *b;
   *b = temp;
@@ -1,6 +1,16 @@
 #ifndef EX2_REPO_SORTBUSLINES_H
 #define EX2_REPO_SORTBUSLINES_H
 
+#include <stddef.h>
+
+// The valid range of every field of a bus line
+#define MAX_LINE_NUMBER 999
+#define MIN_LINE_NUMBER 1
+#define MAX_DISTANCE 1000
+#define MIN_DISTANCE 0
+#define MAX_DURATION 100
+#define MIN_DURATION 10
+
 /**
  * A BusLine struct containing a line number, distance from the campus and
  * duration to get to the campus.
@@ -11,8 +21,51 @@ typedef struct BusLine
 } BusLine;
 
 /**
- * An implementation of the Bubble-Sort algorithm.
+ * Counts of the work the sorts did, for the benchmarks. Every thread counts
+ * its own work.
+ * The sorts only count when built with SORT_COUNTERS defined
+ * (-DSORT_COUNTERS), so they pay nothing for it otherwise.
+ */
+typedef struct SortCounters
+{
+  unsigned long long comparisons, swaps;
+} SortCounters;
+
+#if defined(__GNUC__)
+#define SORT_THREAD_LOCAL __thread
+#else
+#define SORT_THREAD_LOCAL
+#endif
+
+extern SORT_THREAD_LOCAL SortCounters sort_counters;
+
+#ifdef SORT_COUNTERS
+// Sorts count their comparisons in bulk, outside of their inner loops
+#define COUNT_COMPARISONS(count) (sort_counters.comparisons += (count))
+#define COUNT_SWAPS(count) (sort_counters.swaps += (count))
+#else
+#define COUNT_COMPARISONS(count) ((void) (count))
+#define COUNT_SWAPS(count) ((void) (count))
+#endif
+
+/**
+ * The fields a bus line can be sorted by.
+ */
+typedef enum SortKey
+{
+  SORT_BY_DISTANCE,
+  SORT_BY_DURATION,
+  SORT_BY_LINE_NUMBER
+} SortKey;
+
+/**
+ * An implementation of the Bubble-Sort algorithm, sorting by distance.
  * This algorithm is using pointers only.
+ * Arrays whose distances span a small range are counting-sorted instead,
+ * which gives the same (stable) result in linear time.
+ * That's every array of at least COUNTING_SORT_MIN_LENGTH elements with more
+ * elements than the span of its distances - any valid array of 1001 bus
+ * lines or more is counting-sorted, and never bubble-sorted.
  *
  * @param start the start of the array to sort
  * @param end the end of the array to sort
@@ -20,16 +73,253 @@ typedef struct BusLine
 void bubble_sort (BusLine *start, BusLine *end);
 
 /**
- * An implementation of the Quick-Sort algorithm.
+ * The comparison part of bubble-sort, used on any range of distances.
+ * Takes O(N^2) time on any input.
+ *
+ * @param start the start of the array to sort
+ * @param end the end of the array to sort
+ */
+void bubble_sort_loop (BusLine *start, BusLine *end);
+
+// Arrays this small are always sorted by comparisons
+#define COUNTING_SORT_MIN_LENGTH 64
+
+// Ranges this small are left to insertion-sort
+#define INSERTION_SORT_THRESHOLD 16
+
+// Ranges larger than this pick their pivot as the median of three medians
+#define NINTHER_THRESHOLD 128
+
+/**
+ * An implementation of the Quick-Sort algorithm, sorting by duration.
  * This algorithm is using pointers only.
  *
+ * It's an introsort - a quick-sort with median-of-three (or ninther) pivots
+ * and branchless block partitioning, which falls back to heap-sort once the
+ * recursion gets too deep, and leaves small ranges to insertion-sort. It runs
+ * in O(N*log(N)) on any input, and uses O(log(N)) stack.
+ * Arrays whose durations span a small range are counting-sorted instead.
+ * That's every array of at least COUNTING_SORT_MIN_LENGTH elements with more
+ * elements than the span of its durations - any valid array of 91 bus lines
+ * or more is counting-sorted, and never reaches introsort.
+ *
  * @param start the start of the array to sort
  * @param end the end of the array to sort
  */
 void quick_sort (BusLine *start, BusLine *end);
 
 /**
- * Hanldes the partition part of quick-sort.
+ * The comparison part of quick-sort, used on any range of durations.
+ *
+ * @param start the start of the array to sort
+ * @param end the end of the array to sort
+ */
+void introsort (BusLine *start, BusLine *end);
+
+/**
+ * The recursive part of introsort.
+ * Partitions the array until its ranges are smaller than
+ * INSERTION_SORT_THRESHOLD, and heap-sorts a range once ${depth_limit}
+ * partitions didn't get it there. The small ranges are left unsorted.
+ *
+ * @param start the start of the array to sort
+ * @param end the end of the array to sort
+ * @param depth_limit number of partitions allowed before heap-sorting
+ */
+void introsort_loop (BusLine *start, BusLine *end, int depth_limit);
+
+/**
+ * Handles the partition part of introsort.
+ * It selects a pivot (the median of three elements, or of three medians of
+ * three for large arrays) and moves all elements smaller than pivot to its
+ * left, and all elements bigger than pivot to its right. Elements equal to
+ * pivot may end up on either side.
+ *
+ * @param start start of the array to partition, with at least 3 elements
+ * @param end end of the array to partition
+ * @return a pointer to the pivot which is now in the correct position
+ */
+BusLine *partition_median (BusLine *start, BusLine *end);
+
+/**
+ * partition_median by any key.
+ *
+ * @param start start of the array to partition, with at least 3 elements
+ * @param end end of the array to partition
+ * @param key the field to partition by
+ * @return a pointer to the pivot which is now in the correct position
+ */
+BusLine *partition_median_by_key (BusLine *start, BusLine *end, SortKey key);
+
+// Elements a block partition classifies at once on each side - small enough
+// for the offsets to fit in a byte, large enough to hide the swaps' cost
+#define PARTITION_BLOCK_SIZE 64
+
+/**
+ * A branchless partition, in the manner of BlockQuicksort.
+ * It selects a pivot like partition_median, then classifies a block of
+ * elements from each end at a time, writing the offset of every element
+ * and counting only those on the wrong side - so comparing an element never
+ * decides a branch, and random durations don't cost branch mispredictions.
+ * The misplaced elements of both blocks are then swapped in pairs.
+ *
+ * @param start start of the array to partition, with at least 3 elements
+ * @param end end of the array to partition
+ * @return a pointer to the pivot which is now in the correct position
+ */
+BusLine *block_partition (BusLine *start, BusLine *end);
+
+/**
+ * Moves the pivot of the given range to its start - the median of three
+ * elements, or of three medians of three for large arrays.
+ *
+ * @param start start of the range, with at least 3 elements
+ * @param end end of the range
+ */
+void select_pivot (BusLine *start, BusLine *end);
+
+/**
+ * select_pivot by the field at the given offset.
+ *
+ * @param start start of the range, with at least 3 elements
+ * @param end end of the range
+ * @param offset offset of the field to compare, from get_key_offset
+ */
+void select_pivot_by_key (BusLine *start, BusLine *end, size_t offset);
+
+/**
+ * Orders the 3 given elements by duration, so b holds their median.
+ *
+ * @param a pointer to the first element
+ * @param b pointer to the second element
+ * @param c pointer to the third element
+ */
+void median_of_three (BusLine *a, BusLine *b, BusLine *c);
+
+/**
+ * median_of_three by the field at the given offset.
+ *
+ * @param a pointer to the first element
+ * @param b pointer to the second element
+ * @param c pointer to the third element
+ * @param offset offset of the field to compare, from get_key_offset
+ */
+void median_of_three_by_key (BusLine *a, BusLine *b, BusLine *c,
+                             size_t offset);
+
+/**
+ * An implementation of the Heap-Sort algorithm, sorting by duration.
+ *
+ * @param start the start of the array to sort
+ * @param end the end of the array to sort
+ */
+void heap_sort (BusLine *start, BusLine *end);
+
+/**
+ * Sorts the array by the given key with heap-sort, in place.
+ *
+ * @param start the start of the array to sort
+ * @param end the end of the array to sort
+ * @param key the field to sort by
+ */
+void heap_sort_by_key (BusLine *start, BusLine *end, SortKey key);
+
+/**
+ * Moves the element at index root down the max-heap until both its children
+ * have a smaller duration.
+ *
+ * @param start the start of the heap
+ * @param root index of the element to move down
+ * @param length number of elements in the heap
+ */
+void sift_down (BusLine *start, int root, int length);
+
+/**
+ * sift_down by the field at the given offset.
+ *
+ * @param start the start of the heap
+ * @param root index of the element to move down
+ * @param length number of elements in the heap
+ * @param offset offset of the field to compare, from get_key_offset
+ */
+void sift_down_by_key (BusLine *start, int root, int length, size_t offset);
+
+/**
+ * An implementation of the Insertion-Sort algorithm, sorting by duration.
+ * It's linear on arrays where every element is close to its place.
+ *
+ * @param start the start of the array to sort
+ * @param end the end of the array to sort
+ */
+void insertion_sort (BusLine *start, BusLine *end);
+
+/**
+ * Sorts the array by the given key with insertion-sort, in place.
+ *
+ * @param start the start of the array to sort
+ * @param end the end of the array to sort
+ * @param key the field to sort by
+ */
+void insertion_sort_by_key (BusLine *start, BusLine *end, SortKey key);
+
+/**
+ * Checks whether counting-sort would beat a comparison sort on the given
+ * array - it's linear in the array's length plus the range of its keys, so
+ * it's picked when there are fewer possible keys than elements.
+ *
+ * @param start the start of the array
+ * @param end the end of the array
+ * @param key the field the array would be sorted by
+ * @return 1 if the array should be counting-sorted, 0 otherwise
+ */
+int should_counting_sort (BusLine *start, BusLine *end, SortKey key);
+
+/**
+ * A stable implementation of the Counting-Sort algorithm.
+ * It counts every key, and moves each element straight to its place in a
+ * temporary array with a single pass. Takes O(N + range) time and memory.
+ *
+ * @param start the start of the array to sort
+ * @param end the end of the array to sort
+ * @param key the field to sort by
+ * @return 1 if the array was sorted, 0 if memory allocation failed (and the
+ *         array is unchanged)
+ */
+int counting_sort (BusLine *start, BusLine *end, SortKey key);
+
+/**
+ * Finds the smallest and largest keys in the given array.
+ *
+ * @param start the start of the array
+ * @param end the end of the array
+ * @param key the field to check
+ * @param min set to the smallest key, or 0 for an empty array
+ * @param max set to the largest key, or 0 for an empty array
+ */
+void get_key_range (BusLine *start, BusLine *end, SortKey key, int *min,
+                    int *max);
+
+/**
+ * Returns the offset of the given key's field inside a BusLine.
+ *
+ * @param key the field to locate
+ */
+size_t get_key_offset (SortKey key);
+
+/**
+ * Returns the value of the field at the given offset of a bus line.
+ * Defined here so the sorts' inner loops inline it.
+ *
+ * @param line the bus line
+ * @param offset offset of the field, from get_key_offset
+ */
+static inline int get_key_value (const BusLine *line, size_t offset)
+{
+  return *(const int *) ((const char *) line + offset);
+}
+
+/**
+ * The original partition of quick-sort, kept as a reference.
  * It selects a pivot (the last element) and moves all elements smaller than
  * pivot to itself, and all elements bigger than pivot to the right.
  *
@@ -41,6 +331,7 @@ BusLine *partition (BusLine *start, BusLine *end);
 
 /**
  * An algorithm to swap the values of the given two pointers.
+ * Every swap is counted in sort_counters, with SORT_COUNTERS.
  *
  * @param a pointer to the first element
  * @param b pointer to the second element
@@ -1,11 +1,19 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "key_sort_bus_lines.h"
+#include "load_bus_lines.h"
 #include "sort_bus_lines.h"
 #include "test_bus_lines.h"
 
+static int is_equal_slow (BusLine *start_sorted, BusLine *start_original,
+                          int length);
+
 // [=== TESTS ===]
 
 bool test_bubble_sort (BusLine *start, BusLine *end)
@@ -72,6 +80,46 @@ bool test_same_objects_quick_sort (BusLine *start, BusLine *end)
   return result != 0;
 }
 
+bool test_load_bus_lines_csv (void)
+{
+  const char rows[] = "5,0000000000000000000750,20\n"
+                      "0000000000000000000000007,1000,000000000000000000010\n"
+                      "8,99999999999999999999,30\n"
+                      "9,-0000000000000000000001,30\n";
+  BusLine expected[] = { { 5, 750, 20 }, { 7, 1000, 10 } };
+  long expected_bad_rows = 2;
+
+  char path[] = "/tmp/test_bus_lines_XXXXXX";
+  int fd = mkstemp (path);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  ssize_t written = write (fd, rows, sizeof (rows) - 1);
+  close (fd);
+
+  BusLines lines;
+  LoadReport report;
+  LoadStatus status = written == (ssize_t) (sizeof (rows) - 1)
+                          ? load_bus_lines_csv (path, &lines, &report)
+                          : LOAD_FILE_ERROR;
+  unlink (path);
+
+  if (status != LOAD_SUCCESS)
+  {
+    return false;
+  }
+
+  int length = sizeof (expected) / sizeof (expected[0]);
+  bool result = get_number_of_elements (lines.start, lines.end) == length
+                && memcmp (lines.start, expected, sizeof (expected)) == 0
+                && report.bad_rows == expected_bad_rows;
+  release_bus_lines (&lines);
+
+  return result;
+}
+
 // [=== CHECKS ===]
 
 int is_sorted_by_distance (BusLine *start, BusLine *end)
@@ -115,9 +163,52 @@ int is_equal (BusLine *start_sorted, BusLine *end_sorted,
     return 0;
   }
 
-  for (int i = 0; i < length_original; i++)
+  // Sorting copies of both arrays by all of their fields lines up equal
+  // multisets, so they compare in O(n log n) rather than a search per line.
+  BusLine *start_first, *end_first, *start_second, *end_second;
+  if (!copy_array (start_sorted, end_sorted, &start_first, &end_first))
+  {
+    return is_equal_slow (start_sorted, start_original, length_original);
+  }
+  if (!copy_array (start_original, end_original, &start_second, &end_second))
+  {
+    free (start_first);
+    return is_equal_slow (start_sorted, start_original, length_original);
+  }
+
+  SortSpec spec = { { SORT_BY_LINE_NUMBER, SORT_BY_DISTANCE, SORT_BY_DURATION },
+                    { 0, 0, 0 },
+                    MAX_SORT_KEYS };
+
+  int result;
+  if (key_sort (start_first, end_first, &spec)
+      && key_sort (start_second, end_second, &spec))
+  {
+    result = memcmp (start_first, start_second,
+                     length_original * sizeof (BusLine))
+             == 0;
+  }
+  else
+  {
+    result = is_equal_slow (start_sorted, start_original, length_original);
+  }
+
+  free (start_first);
+  free (start_second);
+
+  return result;
+}
+
+/**
+ * Checks that every line of the original array is in the sorted one, with a
+ * search per line. Used when the arrays can't be copied.
+ */
+static int is_equal_slow (BusLine *start_sorted, BusLine *start_original,
+                          int length)
+{
+  for (int i = 0; i < length; i++)
   {
-    if (contains (start_sorted, length_sorted, start_original[i]) == false)
+    if (contains (start_sorted, length, start_original[i]) == false)
     {
       return 0;
     }
@@ -148,7 +239,7 @@ int copy_array (BusLine *start, BusLine *end, BusLine **start_copy_ptr,
   int length = get_number_of_elements (start, end);
 
   *start_copy_ptr = malloc (length * sizeof (BusLine));
-  if (start_copy_ptr == NULL)
+  if (length > 0 && *start_copy_ptr == NULL)
   {
     return 0;
   }
@@ -55,6 +55,15 @@ bool test_quick_sort (BusLine *start, BusLine *end);
  */
 bool test_same_objects_quick_sort (BusLine *start, BusLine *end);
 
+/**
+ * Tests the CSV loader - writes a temporary file with rows whose fields have
+ * long runs of leading zeros, or are too large for an int, loads it and
+ * checks the values of the valid rows and the number of bad ones.
+ *
+ * @return true if the test is successful, false otherwise
+ */
+bool test_load_bus_lines_csv (void);
+
 /**
  * Checks if all bus lines between start and end are sorted by distance.
  *
@@ -75,7 +84,8 @@ int is_sorted_by_duration (BusLine *start, BusLine *end);
 
 /**
  * Checks if the given 2 arrays contain the same elements (might have differnet
- * order though).
+ * order though), with the same number of copies of each.
+ * Sorts copies of both arrays by all of their fields and compares them.
  *
  * @param start_sorted the start of the first array
  * @param end_sorted the end of the first array
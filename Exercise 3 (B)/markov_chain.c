@@ -4,17 +4,13 @@
 
 MarkovNode *get_first_random_node (MarkovChain *markov_chain)
 {
-  MarkovNode *node = NULL;
-  // Keep on drawing random nodes until we get a node that has continuations
-  // and doesn't end with a "."
-  do
+  if (markov_chain->start_states_size == 0)
   {
-    int index = get_random_number (markov_chain->database->size);
-    node = get_node_at_index (markov_chain->database->first, index)->data;
-  } while (markov_chain->is_last (node->data)
-           || node->possible_continuations == 0);
+    return NULL;
+  }
 
-  return node;
+  int index = get_random_number (markov_chain->start_states_size);
+  return markov_chain->start_states[index];
 }
 
 MarkovNode *get_next_random_node (MarkovNode *state_struct_ptr)
@@ -42,6 +38,10 @@ void generate_random_sequence (MarkovChain *markov_chain,
   if (first_node == NULL)
   {
     first_node = get_first_random_node (markov_chain);
+    if (first_node == NULL)
+    {
+      return;
+    }
   }
 
   int current_length = 1;
@@ -87,6 +87,15 @@ void free_markov_chain (MarkovChain **ptr_chain)
     node = next;
   }
 
+  free_index ((*ptr_chain)->index);
+  (*ptr_chain)->index = NULL;
+
+  // The start states point to MarkovNodes freed above
+  free ((*ptr_chain)->start_states);
+  (*ptr_chain)->start_states = NULL;
+  (*ptr_chain)->start_states_size = 0;
+  (*ptr_chain)->start_states_capacity = 0;
+
   // Frees LinkedList (database) and the MarkovChain object.
   (*ptr_chain)->database = NULL;
   *ptr_chain = NULL;
@@ -127,11 +136,30 @@ bool add_node_to_counter_list (MarkovNode *first_node, MarkovNode *second_node,
   }
 
   node->frequency = node->frequency + 1;
+
+  // A state can start a sequence from its first continuation on
+  if (first_node->possible_continuations == 1 && node->frequency == 1)
+  {
+    return add_to_start_states (markov_chain, first_node);
+  }
+
   return true;
 }
 
 Node *get_node_from_database (MarkovChain *markov_chain, void *data_ptr)
 {
+  if (markov_chain->hash_func != NULL)
+  {
+    // The index is created along with the database's first node
+    if (markov_chain->index == NULL)
+    {
+      return NULL;
+    }
+
+    return get_node_from_index (markov_chain->index, markov_chain, data_ptr,
+                                markov_chain->hash_func (data_ptr));
+  }
+
   Node *node = markov_chain->database->first;
 
   while (node != NULL)
@@ -156,15 +184,35 @@ Node *add_to_database (MarkovChain *markov_chain, void *data_ptr)
     return node;
   }
 
+  // Making room in the index first, so the node is never in the database
+  // without being in the index.
+  if (markov_chain->hash_func != NULL && !reserve_index (markov_chain))
+  {
+    return NULL;
+  }
+
   void *copy_data = markov_chain->copy_func (data_ptr);
+  if (copy_data == NULL)
+  {
+    return NULL;
+  }
 
   MarkovNode *m_node = create_markov_node (copy_data);
   if (m_node == NULL || add (markov_chain->database, m_node) == 1)
   {
+    markov_chain->free_data (copy_data);
+    free (m_node);
     return NULL;
   }
 
-  return markov_chain->database->last;
+  node = markov_chain->database->last;
+  if (markov_chain->hash_func != NULL)
+  {
+    add_node_to_index (markov_chain->index, node,
+                       markov_chain->hash_func (copy_data));
+  }
+
+  return node;
 }
 
 // ===== UTILS =====
@@ -206,6 +254,121 @@ NextNodeCounter *get_node_from_counter_list (NextNodeCounter *counter_list,
   return NULL;
 }
 
+Node *get_node_from_index (MarkovIndex *index, MarkovChain *markov_chain,
+                           void *data_ptr, unsigned long hash)
+{
+  unsigned long mask = (unsigned long) index->capacity - 1;
+
+  // Probing the slots after the hash's one, until an empty slot
+  for (unsigned long i = hash & mask; index->slots[i] != NULL;
+       i = (i + 1) & mask)
+  {
+    if (index->hashes[i] == hash
+        && markov_chain->comp_func (index->slots[i]->data->data, data_ptr)
+               == 0)
+    {
+      return index->slots[i];
+    }
+  }
+
+  return NULL;
+}
+
+bool reserve_index (MarkovChain *markov_chain)
+{
+  MarkovIndex *index = markov_chain->index;
+  if (index != NULL && (index->size + 1) * 2 <= index->capacity)
+  {
+    return true;
+  }
+
+  int capacity = index == NULL ? INDEX_INITIAL_CAPACITY : index->capacity * 2;
+
+  MarkovIndex *new_index = malloc (sizeof (MarkovIndex));
+  if (new_index == NULL)
+  {
+    return false;
+  }
+
+  new_index->slots = calloc (capacity, sizeof (Node *));
+  new_index->hashes = malloc (capacity * sizeof (unsigned long));
+  new_index->capacity = capacity;
+  new_index->size = 0;
+
+  if (new_index->slots == NULL || new_index->hashes == NULL)
+  {
+    free_index (new_index);
+    return false;
+  }
+
+  if (index != NULL)
+  {
+    for (int i = 0; i < index->capacity; i++)
+    {
+      if (index->slots[i] != NULL)
+      {
+        add_node_to_index (new_index, index->slots[i], index->hashes[i]);
+      }
+    }
+
+    free_index (index);
+  }
+
+  markov_chain->index = new_index;
+  return true;
+}
+
+void add_node_to_index (MarkovIndex *index, Node *node, unsigned long hash)
+{
+  unsigned long mask = (unsigned long) index->capacity - 1;
+
+  unsigned long i = hash & mask;
+  while (index->slots[i] != NULL)
+  {
+    i = (i + 1) & mask;
+  }
+
+  index->slots[i] = node;
+  index->hashes[i] = hash;
+  index->size++;
+}
+
+bool add_to_start_states (MarkovChain *markov_chain, MarkovNode *node)
+{
+  if (markov_chain->start_states_size == markov_chain->start_states_capacity)
+  {
+    int capacity = markov_chain->start_states_capacity == 0
+                       ? START_STATES_INITIAL_CAPACITY
+                       : markov_chain->start_states_capacity * 2;
+
+    MarkovNode **new_start_states = realloc (
+        markov_chain->start_states, capacity * sizeof (MarkovNode *));
+    if (new_start_states == NULL)
+    {
+      return false;
+    }
+
+    markov_chain->start_states = new_start_states;
+    markov_chain->start_states_capacity = capacity;
+  }
+
+  markov_chain->start_states[markov_chain->start_states_size] = node;
+  markov_chain->start_states_size++;
+  return true;
+}
+
+void free_index (MarkovIndex *index)
+{
+  if (index == NULL)
+  {
+    return;
+  }
+
+  free (index->slots);
+  free (index->hashes);
+  free (index);
+}
+
 MarkovNode *create_markov_node (void *data_ptr)
 {
   MarkovNode *m_node = malloc (sizeof (MarkovNode));
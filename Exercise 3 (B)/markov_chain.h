@@ -9,17 +9,22 @@
 #define ALLOCATION_ERROR_MASSAGE \
   "Allocation failure: Failed to allocate new memory\n"
 
+#define INDEX_INITIAL_CAPACITY 64
+#define START_STATES_INITIAL_CAPACITY 64
+
 /***************************/
 /*   insert typedefs here  */
 /***************************/
 typedef struct MarkovNode MarkovNode;
 typedef struct NextNodeCounter NextNodeCounter;
 typedef struct MarkovChain MarkovChain;
+typedef struct MarkovIndex MarkovIndex;
 
 typedef void (*single_param_void) (void *);
 typedef int (*double_param_int) (void *, void *);
 typedef void *(*single_param_ptr) (void *);
 typedef bool (*single_param_bool) (void *);
+typedef unsigned long (*single_param_hash) (void *);
 /***************************/
 
 /***************************/
@@ -38,7 +43,20 @@ typedef struct NextNodeCounter
   int frequency;
 } NextNodeCounter;
 
-/* DO NOT ADD or CHANGE variable names in this struct */
+/**
+ * An open-addressing hash index over the nodes of a database, with linear
+ * probing. Every slot keeps the hash of its node's data, so probing calls
+ * comp_func only on a full hash match, and growing never hashes again.
+ */
+typedef struct MarkovIndex
+{
+  Node **slots; // NULL for an empty slot
+  unsigned long *hashes;
+  int capacity; // A power of 2, at least twice the size
+  int size;
+} MarkovIndex;
+
+/* DO NOT CHANGE variable names in this struct - new ones go at its end */
 typedef struct MarkovChain
 {
   LinkedList *database;
@@ -67,12 +85,31 @@ typedef struct MarkovChain
   //      - false otherwise.
   single_param_bool is_last;
 
+  // a pointer to a function that gets a pointer of generic data type and
+  // returns its hash - equal data (by comp_func) must have equal hashes.
+  // Optional: if set, add_to_database finds states through a hash index in
+  // O(1) on average, otherwise it scans the whole database.
+  single_param_hash hash_func;
+
+  // the hash index over the database, created by the first add_to_database
+  // when hash_func is set. Should be NULL initially.
+  MarkovIndex *index;
+
+  // the states a sequence may start with - states that aren't last and have
+  // continuations, in the order they got their first one. Kept as the chain
+  // is built, so drawing a first state is a single random index.
+  // Should be NULL and 0 initially.
+  MarkovNode **start_states;
+  int start_states_size;
+  int start_states_capacity;
+
 } MarkovChain;
 
 /**
- * Get one random state from the given markov_chain's database.
+ * Get one random state from the given markov_chain's database, that isn't
+ * last and has continuations.
  * @param markov_chain
- * @return
+ * @return the drawn state, NULL if the database has no such state
  */
 MarkovNode *get_first_random_node (MarkovChain *markov_chain);
 
@@ -115,6 +152,8 @@ bool add_node_to_counter_list (MarkovNode *first_node, MarkovNode *second_node,
 /**
  * Check if data_ptr is in database. If so, return the markov_node wrapping it
  * in the markov_chain, otherwise return NULL.
+ * Looks through the chain's hash index if it has a hash_func, otherwise
+ * scans the whole database.
  * @param markov_chain the chain to look in its database
  * @param data_ptr the state to look for
  * @return Pointer to the Node wrapping given state, NULL if state not in
@@ -159,6 +198,52 @@ NextNodeCounter *get_node_from_counter_list (NextNodeCounter *counter_list,
                                              int list_size,
                                              MarkovNode *target_node);
 
+/**
+ * Returns the node of the database wrapping data_ptr, through the hash index.
+ * @param index index to look in
+ * @param markov_chain the chain whose comp_func compares states
+ * @param data_ptr the state to look for
+ * @param hash the hash of data_ptr
+ * @return Pointer to the Node wrapping given state, NULL if state not in
+ * index.
+ */
+Node *get_node_from_index (MarkovIndex *index, MarkovChain *markov_chain,
+                           void *data_ptr, unsigned long hash);
+
+/**
+ * Makes room in the chain's hash index for one more node, creating the index
+ * if it doesn't exist yet. The index grows twice as large once it's half
+ * full, moving every node by its kept hash.
+ * @param markov_chain the chain whose index to grow
+ * @return true upon success, false in case of allocation error (the index is
+ * unchanged).
+ */
+bool reserve_index (MarkovChain *markov_chain);
+
+/**
+ * Adds the given node to the hash index, which must have room for it.
+ * @param index index to add to
+ * @param node node of the database to add
+ * @param hash the hash of the node's state
+ */
+void add_node_to_index (MarkovIndex *index, Node *node, unsigned long hash);
+
+/**
+ * Adds the given node to the chain's start states, growing them twice as
+ * large once they're full.
+ * @param markov_chain the chain to add to
+ * @param node node that just got its first continuation
+ * @return true upon success, false in case of allocation error (the start
+ * states are unchanged).
+ */
+bool add_to_start_states (MarkovChain *markov_chain, MarkovNode *node);
+
+/**
+ * Frees the given hash index. The nodes it points to are left as they are.
+ * @param index index to free, may be NULL
+ */
+void free_index (MarkovIndex *index);
+
 /**
  * Creates a new MarkovNode object with data ${data_ptr} and returns it
  * @param data_ptr data of the MarkovNode
@@ -141,6 +141,7 @@ static int compare_func (void *item1, void *item2);
 static void free_data (void *item);
 static void *copy_func (void *item);
 static bool is_last (void *item);
+static unsigned long hash_func (void *item);
 
 /**
 * @param argc num of arguments
@@ -168,7 +169,12 @@ int main (int argc, char *argv[])
                               .comp_func = &compare_func,
                               .free_data = &free_data,
                               .copy_func = &copy_func,
-                              .is_last = &is_last };
+                              .is_last = &is_last,
+                              .hash_func = &hash_func,
+                              .index = NULL,
+                              .start_states = NULL,
+                              .start_states_size = 0,
+                              .start_states_capacity = 0 };
  MarkovChain *markov_chain_ptr = &markov_chain;
 
  return run_paths_generator (paths, markov_chain_ptr);
@@ -262,4 +268,11 @@ static bool is_last (void *item)
  Cell *object = (Cell *) item;
 
  return object->number == BOARD_SIZE;
+}
+
+static unsigned long hash_func (void *item)
+{
+ Cell *object = (Cell *) item;
+
+ return (unsigned long) object->number;
 }
\ No newline at end of file
@@ -13,6 +13,10 @@
 #define ARGS_5(x) (x == 5)
 #define ACCEPTED_ARG_COUNT(x) (ARGS_4 (x) || ARGS_5 (x))
 
+// FNV-1a's 64-bit parameters
+#define FNV_OFFSET_BASIS 14695981039346656037UL
+#define FNV_PRIME 1099511628211UL
+
 #define FILE_ERROR "Error: Unable to open file %s\n"
 #define USAGE_MESSAGE \
   "Usage: Please use ./tweets_generator <seed> <number of tweets> <text " \
@@ -32,6 +36,7 @@ static int compare_func (void *item1, void *item2);
 static void free_data (void *item);
 static void *copy_func (void *item);
 static bool is_last (void *item);
+static unsigned long hash_func (void *item);
 
 // ===== Implementations =====
 int main (int argc, char *argv[])
@@ -88,7 +93,12 @@ static int run_tweets_generator (unsigned int seed, unsigned int tweets_number,
     comp_func : &compare_func,
     free_data : &free_data,
     copy_func : &copy_func,
-    is_last : &is_last
+    is_last : &is_last,
+    hash_func : &hash_func,
+    index : NULL,
+    start_states : NULL,
+    start_states_size : 0,
+    start_states_capacity : 0
   };
   MarkovChain *markov_chain_ptr = &markov_chain;
 
@@ -155,6 +165,10 @@ static int insert_word_to_database (MarkovChain *markov_chain, char *word,
   // }
 
   *current_node = add_to_database (markov_chain, word);
+  if (*current_node == NULL)
+  {
+    return EXIT_FAILURE;
+  }
 
   if (*previous_node != NULL)
   {
@@ -207,4 +221,18 @@ static bool is_last (void *item)
   char *str = (char *) item;
 
   return str[strlen (str) - 1] == '.';
+}
+
+static unsigned long hash_func (void *item)
+{
+  unsigned char *str = (unsigned char *) item;
+  unsigned long hash = FNV_OFFSET_BASIS;
+
+  while (*str != '\0')
+  {
+    hash = (hash ^ *str) * FNV_PRIME;
+    str++;
+  }
+
+  return hash;
 }
\ No newline at end of file